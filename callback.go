@@ -0,0 +1,32 @@
+package main
+
+/*
+typedef void (*clivekit_data_callback_fn)(const void *packet, void *user_data);
+
+static __thread int clivekit_callback_depth;
+
+static void clivekit_invoke_data_callback(void *callback, const void *packet, void *user_data) {
+	clivekit_callback_depth++;
+	((clivekit_data_callback_fn)callback)(packet, user_data);
+	clivekit_callback_depth--;
+}
+
+static int clivekit_in_data_callback(void) {
+	return clivekit_callback_depth != 0;
+}
+*/
+import "C"
+
+import (
+	"unsafe"
+)
+
+func invokeDataCallback(callback, packet, userData unsafe.Pointer) {
+	C.clivekit_invoke_data_callback(callback, packet, userData)
+}
+
+// inDataCallback reports whether the current thread runs a data callback
+// of some room.
+func inDataCallback() bool {
+	return C.clivekit_in_data_callback() != 0
+}
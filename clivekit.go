@@ -1,6 +1,7 @@
 package main
 
 /*
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -8,6 +9,10 @@ package main
 #define CLIVEKIT_SIZE_IDENT  32
 #define CLIVEKIT_SIZE_ENCKEY 32 // 256-bit key
 #define CLIVEKIT_SIZE_BUFFER 4096
+#define CLIVEKIT_SIZE_MESSAGE (1 << 16)
+#define CLIVEKIT_SIZE_DTYPES 5
+#define CLIVEKIT_SIZE_DROPS 13
+#define CLIVEKIT_SIZE_LATENCY 16 // bucket i: < (256ns << i), last: the rest
 
 typedef enum {
 	CLIVEKIT_ETYPE_SUCCESS,
@@ -16,7 +21,15 @@ typedef enum {
 	CLIVEKIT_ETYPE_GET_ROOM,
 	CLIVEKIT_ETYPE_PUBLISH,
 	CLIVEKIT_ETYPE_RECEIVE,
-	CLIVEKIT_ETYPE_CREATE_ROOM
+	CLIVEKIT_ETYPE_CREATE_ROOM,
+	CLIVEKIT_ETYPE_ACTIVATE_KEY,
+	CLIVEKIT_ETYPE_QUEUE_FULL,
+	CLIVEKIT_ETYPE_NO_DATA,
+	CLIVEKIT_ETYPE_NOTIFY,
+	CLIVEKIT_ETYPE_TRACK,
+	CLIVEKIT_ETYPE_FORMAT,
+	CLIVEKIT_ETYPE_COMPRESS,
+	CLIVEKIT_ETYPE_RUNTIME
 } clivekit_error_type;
 
 typedef enum {
@@ -27,12 +40,72 @@ typedef enum {
 	CLIVEKIT_DTYPE_VIDEO
 } clivekit_data_type;
 
+#define CLIVEKIT_DTYPE_MASK(t) (1u << (t))
+#define CLIVEKIT_DTYPE_MASK_ALL ((1u << CLIVEKIT_SIZE_DTYPES) - 1)
+
+typedef enum {
+	CLIVEKIT_POLICY_BLOCK, // clivekit_enqueue_data_to_room waits, clivekit_try_write_data_to_room returns QUEUE_FULL
+	CLIVEKIT_POLICY_DROP_OLDEST,
+	CLIVEKIT_POLICY_DROP_NEWEST
+} clivekit_queue_policy;
+
+typedef enum {
+	CLIVEKIT_COMPRESS_NONE,
+	CLIVEKIT_COMPRESS_S2,  // fast, for latency
+	CLIVEKIT_COMPRESS_ZSTD // better ratio, with the shared dictionary
+} clivekit_compression;
+
+typedef enum {
+	CLIVEKIT_STATE_CONNECTING,
+	CLIVEKIT_STATE_CONNECTED,
+	CLIVEKIT_STATE_RECONNECTING, // keys, queues and tracks are kept
+	CLIVEKIT_STATE_FAILED
+} clivekit_connect_state;
+
+typedef enum {
+	CLIVEKIT_DROP_NOT_USER_DATA,
+	CLIVEKIT_DROP_UNKNOWN_KEY,
+	CLIVEKIT_DROP_DECRYPT,
+	CLIVEKIT_DROP_BAD_FRAME,
+	CLIVEKIT_DROP_OVERSIZE,
+	CLIVEKIT_DROP_NO_BUFFER,
+	CLIVEKIT_DROP_INCOMPLETE,
+	CLIVEKIT_DROP_QUEUE_FULL,
+	CLIVEKIT_DROP_HANDLER_BUSY,
+	CLIVEKIT_DROP_CLOSED,
+	CLIVEKIT_DROP_LATE,
+	CLIVEKIT_DROP_UNSUBSCRIBED,
+	CLIVEKIT_DROP_DECRYPT_BACKLOG // frames, not messages
+} clivekit_drop_reason;
+
+typedef struct {
+	size_t                depth;  // 0 = default (2048 messages)
+	clivekit_queue_policy policy; // BLOCK = default of the data type
+	unsigned              weight; // 0 for all types = strict priority
+} clivekit_recv_queue_config;
+
+typedef struct {
+	uint32_t latency_us;
+	uint32_t jitter_us; // uniform, added to the latency
+	double   loss;      // probability, lossy messages only
+	double   reorder;   // probability of a lossy message arriving late
+	uint64_t bandwidth; // bytes per second, 0 = unlimited
+	uint64_t seed;      // 0 = random
+} clivekit_loopback_config;
+
 typedef struct {
-	char *host;
+	char *host; // "loopback://<name>" connects in process without a server
 	char *api_key;
 	char *api_secret;
 	char *room_name;
 	char *ident;
+	size_t send_queue_size; // 0 = default (256 messages)
+	size_t recv_budget;     // 0 = default (8 MiB)
+	clivekit_recv_queue_config recv_queues[CLIVEKIT_SIZE_DTYPES]; // by data type
+	clivekit_loopback_config loopback; // impairs the link of a loopback host
+	size_t compress_min_size;  // 0 = default (256 bytes)
+	const void *compress_dict; // zstd dictionary shared by the peers, may be NULL
+	size_t compress_dict_size;
 } clivekit_connect_info;
 
 typedef struct {
@@ -41,33 +114,253 @@ typedef struct {
 	char              payload[CLIVEKIT_SIZE_BUFFER];
 	size_t            payload_size;
 } clivekit_data_packet;
+
+typedef struct {
+	clivekit_data_type dtype;
+	char              ident[CLIVEKIT_SIZE_IDENT];
+	const char       *payload;
+	size_t            payload_size;
+	uintptr_t         handle;
+} clivekit_borrowed_packet;
+
+typedef enum {
+	CLIVEKIT_SAMPLE_F32, // native endian
+	CLIVEKIT_SAMPLE_S16,
+	CLIVEKIT_SAMPLE_S24, // low three bytes of 32 bits
+	CLIVEKIT_SAMPLE_S32,
+	CLIVEKIT_SAMPLE_F64
+} clivekit_sample_format;
+
+typedef struct {
+	uint32_t sample_rate;
+	uint32_t channels; // 1 or 2 for tracks, samples are interleaved
+	clivekit_sample_format sample_format;
+} clivekit_audio_format;
+
+// Conversion kernels for the PCM of audio devices, called without entering
+// Go. Integer samples are clamped. Returns -1 for an unknown format.
+extern int clivekit_convert_samples(void *dst, clivekit_sample_format dst_format, const void *src, clivekit_sample_format src_format, size_t count);
+extern void clivekit_interleave_f32(float *dst, const float *const *planes, size_t channels, size_t frames);
+extern void clivekit_deinterleave_f32(float *const *planes, const float *src, size_t channels, size_t frames);
+
+typedef struct {
+	uint32_t width;
+	uint32_t height;
+} clivekit_video_format;
+
+typedef struct {
+	const void *base;
+	size_t      len;
+} clivekit_iovec;
+
+typedef void (*clivekit_data_callback)(const clivekit_borrowed_packet *packet, void *user_data);
+
+typedef struct {
+	size_t   length;
+	size_t   capacity;
+	size_t   bytes;
+	uint64_t dropped;
+	uint64_t failed;
+} clivekit_send_queue_state;
+
+typedef struct {
+	uint64_t packets_in[CLIVEKIT_SIZE_DTYPES];  // by data type
+	uint64_t bytes_in[CLIVEKIT_SIZE_DTYPES];
+	uint64_t packets_out[CLIVEKIT_SIZE_DTYPES];
+	uint64_t bytes_out[CLIVEKIT_SIZE_DTYPES];
+	uint64_t drops[CLIVEKIT_SIZE_DROPS];        // by drop reason
+	size_t   queue_length;
+	size_t   queue_high_water;
+	size_t   queue_bytes;
+	uint64_t encrypt_latency[CLIVEKIT_SIZE_LATENCY];
+	uint64_t decrypt_latency[CLIVEKIT_SIZE_LATENCY];
+} clivekit_room_stats;
+
+typedef struct {
+	int     max_procs;    // GOMAXPROCS, 0 = keep
+	int     gc_percent;   // GOGC, 0 = keep, < 0 = off
+	int64_t memory_limit; // GOMEMLIMIT in bytes, 0 = keep, < 0 = none
+} clivekit_runtime_config;
+
+typedef struct {
+	clivekit_runtime_config config; // off settings are -1
+	uint64_t heap_bytes;  // heap objects, live or not yet swept
+	uint64_t heap_goal;   // heap size of the next collection
+	uint64_t total_bytes; // mapped by the runtime
+	uint64_t goroutines;
+	uint64_t gc_cycles;
+	uint64_t gc_pauses;   // stop-the-world pauses since the start
+	uint64_t gc_pause_p50_ns;
+	uint64_t gc_pause_p99_ns;
+	uint64_t gc_pause_p999_ns;
+	uint64_t gc_pause_max_ns;
+} clivekit_runtime_stats;
 */
 // #cgo LDFLAGS: -lsoxr -lopus -lopusfile
 import "C"
 
 import (
 	"context"
-	"crypto/rand"
+	"errors"
+	"math"
+	"sync"
+	"time"
 	"unsafe"
 
 	lksdk "github.com/livekit/server-sdk-go/v2"
+	"github.com/number571/clivekit/internal/audio"
+	"github.com/number571/clivekit/internal/compress"
 	"github.com/number571/clivekit/internal/crypto"
+	"github.com/number571/clivekit/internal/loopback"
+	"github.com/number571/clivekit/internal/pool"
 	"github.com/number571/clivekit/internal/room"
-)
-
-type (
-	descType [C.CLIVEKIT_SIZE_DESC]byte
+	"github.com/number571/clivekit/internal/tuning"
 )
 
 var (
 	roomManager = room.NewRoomManager()
+
+	// packet slices of batch reads, reused between calls
+	batchPool = sync.Pool{New: func() any { return new([]*room.DataPacket) }}
+
+	// polls share a context which has already expired, instead of
+	// creating a timer per call
+	expiredCtx, _ = context.WithDeadline(context.Background(), time.Unix(0, 0))
 )
 
 //export clivekit_connect_to_room
 func clivekit_connect_to_room(room_desc *C.char, conn_info C.clivekit_connect_info) C.clivekit_error_type {
-	connInfo := &room.ConnectInfo{
-		Host:     C.GoString(conn_info.host),
-		BuffSize: C.CLIVEKIT_SIZE_BUFFER,
+	room, err := room.ConnectToSecureRoom(convertConnectInfo(&conn_info))
+	if err != nil {
+		return C.CLIVEKIT_ETYPE_CONNECT
+	}
+
+	if ok := createRoomContext(room_desc, room); !ok {
+		room.Close()
+		return C.CLIVEKIT_ETYPE_CREATE_ROOM
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_connect_to_room_async
+func clivekit_connect_to_room_async(room_desc *C.char, conn_info C.clivekit_connect_info) C.clivekit_error_type {
+	room := room.ConnectToSecureRoomAsync(convertConnectInfo(&conn_info))
+
+	if ok := createRoomContext(room_desc, room); !ok {
+		room.Close()
+		return C.CLIVEKIT_ETYPE_CREATE_ROOM
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_get_connect_state
+func clivekit_get_connect_state(room_desc *C.char, state *C.clivekit_connect_state) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	switch rc.GetConnectState() {
+	case room.ConnectingState:
+		*state = C.CLIVEKIT_STATE_CONNECTING
+	case room.ConnectedState:
+		*state = C.CLIVEKIT_STATE_CONNECTED
+	case room.ReconnectingState:
+		*state = C.CLIVEKIT_STATE_RECONNECTING
+	default:
+		*state = C.CLIVEKIT_STATE_FAILED
+	}
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_drop_loopback_link
+func clivekit_drop_loopback_link(room_desc *C.char) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	if err := rc.DropLoopbackLink(); err != nil {
+		return C.CLIVEKIT_ETYPE_CONNECT
+	}
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_connect_to_rooms
+func clivekit_connect_to_rooms(room_descs **C.char, conn_infos *C.clivekit_connect_info, count C.size_t, results *C.clivekit_error_type) C.clivekit_error_type {
+	var (
+		cDescs     = unsafe.Slice(room_descs, int(count))
+		cConnInfos = unsafe.Slice(conn_infos, int(count))
+		cResults   = unsafe.Slice(results, int(count))
+		connInfos  = make([]*room.ConnectInfo, len(cConnInfos))
+		status     = C.clivekit_error_type(C.CLIVEKIT_ETYPE_SUCCESS)
+	)
+	for i := range cConnInfos {
+		connInfos[i] = convertConnectInfo(&cConnInfos[i])
+	}
+
+	rooms, errs := room.ConnectToSecureRooms(connInfos)
+	for i, rc := range rooms {
+		cResults[i] = C.CLIVEKIT_ETYPE_SUCCESS
+		if errs[i] != nil {
+			cResults[i] = C.CLIVEKIT_ETYPE_CONNECT
+			status = C.CLIVEKIT_ETYPE_CONNECT
+			continue
+		}
+		if ok := createRoomContext(cDescs[i], rc); !ok {
+			rc.Close()
+			cResults[i] = C.CLIVEKIT_ETYPE_CREATE_ROOM
+			status = C.CLIVEKIT_ETYPE_CONNECT
+		}
+	}
+	return status
+}
+
+//export clivekit_disconnect_from_rooms
+func clivekit_disconnect_from_rooms(room_descs **C.char, count C.size_t, results *C.clivekit_error_type) C.clivekit_error_type {
+	var (
+		cDescs   = unsafe.Slice(room_descs, int(count))
+		cResults = unsafe.Slice(results, int(count))
+		rooms    = make([]room.IRoom, 0, len(cDescs))
+		status   = C.clivekit_error_type(C.CLIVEKIT_ETYPE_SUCCESS)
+	)
+
+	// closing waits for the running callbacks to return
+	if inDataCallback() {
+		for i := range cResults {
+			cResults[i] = C.CLIVEKIT_ETYPE_CLOSE
+		}
+		return C.CLIVEKIT_ETYPE_CLOSE
+	}
+
+	for i, desc := range cDescs {
+		rc, ok := roomManager.Del(loadRoomDesc(desc))
+		if !ok {
+			cResults[i] = C.CLIVEKIT_ETYPE_CLOSE
+			status = C.CLIVEKIT_ETYPE_CLOSE
+			continue
+		}
+		cResults[i] = C.CLIVEKIT_ETYPE_SUCCESS
+		rooms = append(rooms, rc)
+	}
+
+	room.CloseRooms(rooms)
+	return status
+}
+
+func convertConnectInfo(conn_info *C.clivekit_connect_info) *room.ConnectInfo {
+	return &room.ConnectInfo{
+		Host:            C.GoString(conn_info.host),
+		BuffSize:        C.CLIVEKIT_SIZE_MESSAGE,
+		SendQueueSize:   int(conn_info.send_queue_size),
+		RecvQueues:      convertRecvQueues(&conn_info.recv_queues),
+		RecvBudget:      int(conn_info.recv_budget),
+		Allocator:       cAllocator{},
+		Loopback:        convertLoopbackConfig(&conn_info.loopback),
+		CompressDict:    C.GoBytes(conn_info.compress_dict, C.int(conn_info.compress_dict_size)),
+		CompressMinSize: int(conn_info.compress_min_size),
 		ConnectInfo: lksdk.ConnectInfo{
 			APIKey:              C.GoString(conn_info.api_key),
 			APISecret:           C.GoString(conn_info.api_secret),
@@ -75,20 +368,59 @@ func clivekit_connect_to_room(room_desc *C.char, conn_info C.clivekit_connect_in
 			ParticipantIdentity: C.GoString(conn_info.ident),
 		},
 	}
+}
 
-	room, err := room.ConnectToSecureRoom(connInfo)
+//export clivekit_set_decrypt_workers
+func clivekit_set_decrypt_workers(count C.size_t) {
+	room.SetDecryptWorkers(int(count))
+}
+
+//export clivekit_runtime_configure
+func clivekit_runtime_configure(config *C.clivekit_runtime_config, previous *C.clivekit_runtime_config) C.clivekit_error_type {
+	prev, err := tuning.Configure(tuning.Config{
+		MaxProcs:    int(config.max_procs),
+		GCPercent:   int(config.gc_percent),
+		MemoryLimit: int64(config.memory_limit),
+	})
 	if err != nil {
-		return C.CLIVEKIT_ETYPE_CONNECT
+		return C.CLIVEKIT_ETYPE_RUNTIME
 	}
-
-	if ok := createRoomContext(room_desc, room); !ok {
-		room.Close()
-		return C.CLIVEKIT_ETYPE_CREATE_ROOM
+	if config.max_procs != 0 {
+		room.FollowMaxProcs(int(config.max_procs))
+	}
+	if previous != nil {
+		convertRuntimeConfig(previous, &prev)
 	}
-
 	return C.CLIVEKIT_ETYPE_SUCCESS
 }
 
+//export clivekit_get_runtime_stats
+func clivekit_get_runtime_stats(runtime_stats *C.clivekit_runtime_stats) {
+	var stats tuning.Stats
+	tuning.ReadStats(&stats)
+
+	convertRuntimeConfig(&runtime_stats.config, &stats.Config)
+	runtime_stats.heap_bytes = C.uint64_t(stats.HeapBytes)
+	runtime_stats.heap_goal = C.uint64_t(stats.HeapGoal)
+	runtime_stats.total_bytes = C.uint64_t(stats.TotalBytes)
+	runtime_stats.goroutines = C.uint64_t(stats.Goroutines)
+	runtime_stats.gc_cycles = C.uint64_t(stats.GCCycles)
+	runtime_stats.gc_pauses = C.uint64_t(stats.GCPauses)
+	runtime_stats.gc_pause_p50_ns = C.uint64_t(stats.GCPauseP50)
+	runtime_stats.gc_pause_p99_ns = C.uint64_t(stats.GCPauseP99)
+	runtime_stats.gc_pause_p999_ns = C.uint64_t(stats.GCPauseP999)
+	runtime_stats.gc_pause_max_ns = C.uint64_t(stats.GCPauseMax)
+}
+
+//export clivekit_set_seal_parallel_threshold
+func clivekit_set_seal_parallel_threshold(size C.size_t) {
+	if uint64(size) > math.MaxInt {
+		room.SetSealParallelThreshold(-1)
+		return
+	}
+	room.SetSealParallelThreshold(int(size))
+}
+
 //export clivekit_disconnect_from_room
 func clivekit_disconnect_from_room(room_desc *C.char) C.clivekit_error_type {
 	if ok := closeRoomContextByDesc(room_desc); !ok {
@@ -99,7 +431,7 @@ func clivekit_disconnect_from_room(room_desc *C.char) C.clivekit_error_type {
 
 //export clivekit_add_rx_key_for_room
 func clivekit_add_rx_key_for_room(room_desc, ident, rx_key *C.char) C.clivekit_error_type {
-	rc, _, ok := getRoomContextByDesc(room_desc)
+	rc, ok := getRoomContextByDesc(room_desc)
 	if !ok {
 		return C.CLIVEKIT_ETYPE_GET_ROOM
 	}
@@ -111,7 +443,7 @@ func clivekit_add_rx_key_for_room(room_desc, ident, rx_key *C.char) C.clivekit_e
 
 //export clivekit_del_rx_key_for_room
 func clivekit_del_rx_key_for_room(room_desc, ident *C.char) C.clivekit_error_type {
-	rc, _, ok := getRoomContextByDesc(room_desc)
+	rc, ok := getRoomContextByDesc(room_desc)
 	if !ok {
 		return C.CLIVEKIT_ETYPE_GET_ROOM
 	}
@@ -122,7 +454,7 @@ func clivekit_del_rx_key_for_room(room_desc, ident *C.char) C.clivekit_error_typ
 
 //export clivekit_set_tx_key_for_room
 func clivekit_set_tx_key_for_room(room_desc, tx_key *C.char) C.clivekit_error_type {
-	rc, _, ok := getRoomContextByDesc(room_desc)
+	rc, ok := getRoomContextByDesc(room_desc)
 	if !ok {
 		return C.CLIVEKIT_ETYPE_GET_ROOM
 	}
@@ -132,27 +464,134 @@ func clivekit_set_tx_key_for_room(room_desc, tx_key *C.char) C.clivekit_error_ty
 	return C.CLIVEKIT_ETYPE_SUCCESS
 }
 
+//export clivekit_stage_rx_key_for_room
+func clivekit_stage_rx_key_for_room(room_desc, ident *C.char, key_id C.uint8_t, rx_key *C.char) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	key := C.GoBytes(unsafe.Pointer(rx_key), C.CLIVEKIT_SIZE_ENCKEY)
+	rc.GetCipherManager().StageRX(C.GoString(ident), uint8(key_id), crypto.NewCipher(key))
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_stage_tx_key_for_room
+func clivekit_stage_tx_key_for_room(room_desc *C.char, key_id C.uint8_t, tx_key *C.char) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	key := C.GoBytes(unsafe.Pointer(tx_key), C.CLIVEKIT_SIZE_ENCKEY)
+	rc.GetCipherManager().StageTX(uint8(key_id), crypto.NewCipher(key))
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_activate_tx_key_for_room
+func clivekit_activate_tx_key_for_room(room_desc *C.char, key_id C.uint8_t) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	if ok := rc.GetCipherManager().ActivateTX(uint8(key_id)); !ok {
+		return C.CLIVEKIT_ETYPE_ACTIVATE_KEY
+	}
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
 //export clivekit_read_data_from_room
 func clivekit_read_data_from_room(room_desc *C.char, data_packet *C.clivekit_data_packet) C.clivekit_error_type {
-	rc, _, ok := getRoomContextByDesc(room_desc)
+	return readDataPacket(room_desc, data_packet, -1)
+}
+
+//export clivekit_try_read_data_from_room
+func clivekit_try_read_data_from_room(room_desc *C.char, data_packet *C.clivekit_data_packet) C.clivekit_error_type {
+	return readDataPacket(room_desc, data_packet, 0)
+}
+
+//export clivekit_read_data_from_room_timeout
+func clivekit_read_data_from_room_timeout(room_desc *C.char, data_packet *C.clivekit_data_packet, timeout_ms C.int) C.clivekit_error_type {
+	return readDataPacket(room_desc, data_packet, timeout_ms)
+}
+
+//export clivekit_read_borrowed_from_room
+func clivekit_read_borrowed_from_room(room_desc *C.char, borrowed_packet *C.clivekit_borrowed_packet) C.clivekit_error_type {
+	return readBorrowedPacket(room_desc, borrowed_packet, -1)
+}
+
+//export clivekit_read_borrowed_from_room_timeout
+func clivekit_read_borrowed_from_room_timeout(room_desc *C.char, borrowed_packet *C.clivekit_borrowed_packet, timeout_ms C.int) C.clivekit_error_type {
+	return readBorrowedPacket(room_desc, borrowed_packet, timeout_ms)
+}
+
+//export clivekit_get_room_fd
+func clivekit_get_room_fd(room_desc *C.char, fd *C.int) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
 	if !ok {
 		return C.CLIVEKIT_ETYPE_GET_ROOM
 	}
 
-	td, err := rc.ReceiveDataPacket(context.Background())
+	readyFD, err := rc.GetReadyFD()
 	if err != nil {
-		return C.CLIVEKIT_ETYPE_RECEIVE
+		return C.CLIVEKIT_ETYPE_NOTIFY
+	}
+
+	*fd = C.int(readyFD)
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_release_packet
+func clivekit_release_packet(borrowed_packet *C.clivekit_borrowed_packet) {
+	buffer, ok := pool.TakeLent(uintptr(borrowed_packet.handle))
+	if !ok {
+		return
+	}
+
+	borrowed_packet.payload = nil
+	borrowed_packet.payload_size = 0
+	borrowed_packet.handle = 0
+
+	buffer.Release()
+}
+
+//export clivekit_read_batch_from_room
+func clivekit_read_batch_from_room(room_desc *C.char, data_packets *C.clivekit_data_packet, max_count C.size_t, count *C.size_t, timeout_ms C.int) C.clivekit_error_type {
+	*count = 0
+
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	if max_count == 0 {
+		return C.CLIVEKIT_ETYPE_SUCCESS
+	}
+
+	ctx, cancel := timeoutContext(timeout_ms)
+	defer cancel()
+
+	batch := batchPool.Get().(*[]*room.DataPacket)
+	defer batchPool.Put(batch)
+	if uint64(cap(*batch)) < uint64(max_count) {
+		*batch = make([]*room.DataPacket, int(max_count))
 	}
+	tds := (*batch)[:int(max_count)]
 
-	cPayloadSize := C.size_t(len(td.Payload))
-	cIdent := C.CString(td.Ident)
-	defer C.free(unsafe.Pointer(cIdent))
+	n, err := rc.ReceiveDataPackets(ctx, tds, C.CLIVEKIT_SIZE_BUFFER)
+	if err != nil && !errors.Is(err, context.DeadlineExceeded) {
+		return C.CLIVEKIT_ETYPE_RECEIVE
+	}
 
-	data_packet.dtype = C.clivekit_data_type(td.Type)
-	data_packet.payload_size = cPayloadSize
-	C.memcpy(unsafe.Pointer(&data_packet.ident), unsafe.Pointer(cIdent), C.size_t(len(td.Ident)+1))
-	C.memcpy(unsafe.Pointer(&data_packet.payload), unsafe.Pointer(&td.Payload[0]), cPayloadSize)
+	cPackets := unsafe.Slice(data_packets, int(max_count))
+	for i := 0; i < n; i++ {
+		copyDataPacket(&cPackets[i], tds[i])
+		tds[i].Release()
+		tds[i] = nil
+	}
 
+	*count = C.size_t(n)
 	return C.CLIVEKIT_ETYPE_SUCCESS
 }
 
@@ -160,19 +599,20 @@ func clivekit_read_data_from_room(room_desc *C.char, data_packet *C.clivekit_dat
 func clivekit_write_data_to_room(room_desc *C.char, data_type C.clivekit_data_type, data *C.char, data_size C.size_t) C.clivekit_error_type {
 	ctx := context.Background()
 
-	rc, _, ok := getRoomContextByDesc(room_desc)
+	rc, ok := getRoomContextByDesc(room_desc)
 	if !ok {
 		return C.CLIVEKIT_ETYPE_GET_ROOM
 	}
 
+	// the payload is sealed straight from the memory of the caller
 	var (
-		fullPayload = C.GoBytes(unsafe.Pointer(data), C.int(data_size))
+		fullPayload = unsafe.Slice((*byte)(unsafe.Pointer(data)), int(data_size))
 		fullPldSize = uint64(data_size)
 		sDataPacket = &room.DataPacket{Type: convertDataType(data_type)}
 	)
 
-	for i := uint64(0); i < fullPldSize; i += C.CLIVEKIT_SIZE_BUFFER {
-		end := i + C.CLIVEKIT_SIZE_BUFFER
+	for i := uint64(0); i < fullPldSize; i += C.CLIVEKIT_SIZE_MESSAGE {
+		end := i + C.CLIVEKIT_SIZE_MESSAGE
 		if end > fullPldSize {
 			end = fullPldSize
 		}
@@ -185,50 +625,791 @@ func clivekit_write_data_to_room(room_desc *C.char, data_type C.clivekit_data_ty
 	return C.CLIVEKIT_ETYPE_SUCCESS
 }
 
-func convertDataType(data_type C.clivekit_data_type) room.DataType {
-	switch data_type {
-	case C.CLIVEKIT_DTYPE_CUSTOM:
-		return room.CustomDataType
-	case C.CLIVEKIT_DTYPE_TEXT:
-		return room.TextDataType
-	case C.CLIVEKIT_DTYPE_SIGNAL:
-		return room.SignalDataType
-	case C.CLIVEKIT_DTYPE_AUDIO:
-		return room.AudioDataType
-	case C.CLIVEKIT_DTYPE_VIDEO:
-		return room.VideoDataType
+//export clivekit_write_datav_to_room
+func clivekit_write_datav_to_room(room_desc *C.char, data_type C.clivekit_data_type, iov *C.clivekit_iovec, iov_count C.size_t) C.clivekit_error_type {
+	ctx := context.Background()
+
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
 	}
-	panic("unknown data type")
+
+	var (
+		cIovecs  = unsafe.Slice(iov, int(iov_count))
+		vector   = make([][]byte, 0, len(cIovecs))
+		message  = make([][]byte, 0, len(cIovecs))
+		dataType = convertDataType(data_type)
+	)
+	for _, v := range cIovecs {
+		if v.len != 0 {
+			vector = append(vector, unsafe.Slice((*byte)(v.base), int(v.len)))
+		}
+	}
+
+	// the buffers are split into messages of CLIVEKIT_SIZE_MESSAGE bytes
+	// and sealed straight from the memory of the caller
+	for len(vector) != 0 {
+		message = message[:0]
+		for left := C.CLIVEKIT_SIZE_MESSAGE; len(vector) != 0 && left != 0; {
+			if b := vector[0]; len(b) > left {
+				message = append(message, b[:left])
+				vector[0], left = b[left:], 0
+			} else {
+				message = append(message, b)
+				vector, left = vector[1:], left-len(b)
+			}
+		}
+		if err := rc.PublishDataVector(ctx, dataType, message); err != nil {
+			return C.CLIVEKIT_ETYPE_PUBLISH
+		}
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
 }
 
-func createRoomContext(cRoomDesc *C.char, room room.ISecureRoom) bool {
-	var goRoomDesc descType
-	if _, err := rand.Read(goRoomDesc[:]); err != nil {
-		return false
+//export clivekit_write_data_to_rooms
+func clivekit_write_data_to_rooms(room_descs **C.char, count C.size_t, data_type C.clivekit_data_type, data *C.char, data_size C.size_t, results *C.clivekit_error_type) C.clivekit_error_type {
+	ctx := context.Background()
+
+	var (
+		cDescs   = unsafe.Slice(room_descs, int(count))
+		cResults = unsafe.Slice(results, int(count))
+		rooms    = make([]room.ISecureRoom, 0, len(cDescs))
+		indexes  = make([]int, 0, len(cDescs))
+		status   = C.clivekit_error_type(C.CLIVEKIT_ETYPE_SUCCESS)
+	)
+	for i, desc := range cDescs {
+		rc, ok := getRoomContextByDesc(desc)
+		if !ok {
+			cResults[i] = C.CLIVEKIT_ETYPE_GET_ROOM
+			status = C.CLIVEKIT_ETYPE_PUBLISH
+			continue
+		}
+		cResults[i] = C.CLIVEKIT_ETYPE_SUCCESS
+		rooms = append(rooms, rc)
+		indexes = append(indexes, i)
 	}
-	if ok := roomManager.Set(goRoomDesc[:], room); !ok {
-		return false
+
+	// the payload is sealed straight from the memory of the caller
+	var (
+		fullPayload = unsafe.Slice((*byte)(unsafe.Pointer(data)), int(data_size))
+		fullPldSize = uint64(data_size)
+		sDataPacket = &room.DataPacket{Type: convertDataType(data_type)}
+	)
+
+	for i := uint64(0); i < fullPldSize; i += C.CLIVEKIT_SIZE_MESSAGE {
+		end := i + C.CLIVEKIT_SIZE_MESSAGE
+		if end > fullPldSize {
+			end = fullPldSize
+		}
+		sDataPacket.Payload = fullPayload[i:end]
+		for j, err := range room.PublishDataPacketToRooms(ctx, rooms, sDataPacket) {
+			if err != nil && cResults[indexes[j]] == C.CLIVEKIT_ETYPE_SUCCESS {
+				cResults[indexes[j]] = C.CLIVEKIT_ETYPE_PUBLISH
+				status = C.CLIVEKIT_ETYPE_PUBLISH
+			}
+		}
 	}
-	C.memcpy(unsafe.Pointer(cRoomDesc), unsafe.Pointer(&goRoomDesc[0]), C.CLIVEKIT_SIZE_DESC)
-	return true
+
+	return status
 }
 
-func getRoomContextByDesc(cRoomDesc *C.char) (room.ISecureRoom, descType, bool) {
-	var goRoomDesc descType
-	loadDesc := C.GoBytes(unsafe.Pointer(cRoomDesc), C.CLIVEKIT_SIZE_DESC)
-	copy(goRoomDesc[:], loadDesc)
-	v, ok := roomManager.Get(goRoomDesc[:])
-	return v.(room.ISecureRoom), goRoomDesc, ok
+//export clivekit_write_data_to_participants
+func clivekit_write_data_to_participants(room_desc *C.char, idents **C.char, idents_count C.size_t, data_type C.clivekit_data_type, data *C.char, data_size C.size_t) C.clivekit_error_type {
+	ctx := context.Background()
+
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	var (
+		fullPayload = unsafe.Slice((*byte)(unsafe.Pointer(data)), int(data_size))
+		fullPldSize = uint64(data_size)
+		sDataPacket = &room.DataPacket{
+			Type:         convertDataType(data_type),
+			Destinations: convertStrings(idents, idents_count),
+		}
+	)
+
+	for i := uint64(0); i < fullPldSize; i += C.CLIVEKIT_SIZE_MESSAGE {
+		end := i + C.CLIVEKIT_SIZE_MESSAGE
+		if end > fullPldSize {
+			end = fullPldSize
+		}
+		sDataPacket.Payload = fullPayload[i:end]
+		if err := rc.PublishDataPacket(ctx, sDataPacket); err != nil {
+			return C.CLIVEKIT_ETYPE_PUBLISH
+		}
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
 }
 
-func closeRoomContextByDesc(cRoomDesc *C.char) bool {
-	rc, desc, ok := getRoomContextByDesc(cRoomDesc)
+//export clivekit_try_write_data_to_room
+func clivekit_try_write_data_to_room(room_desc *C.char, data_type C.clivekit_data_type, data *C.char, data_size C.size_t) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
 	if !ok {
-		return false
+		return C.CLIVEKIT_ETYPE_GET_ROOM
 	}
-	roomManager.Del(desc[:])
-	rc.Close()
-	return true
+
+	var (
+		fullPayload = unsafe.Slice((*byte)(unsafe.Pointer(data)), int(data_size))
+		fullPldSize = uint64(data_size)
+		dataType    = convertDataType(data_type)
+		err         error
+	)
+
+	switch {
+	case fullPldSize == 0:
+	case fullPldSize <= C.CLIVEKIT_SIZE_MESSAGE:
+		err = rc.TryEnqueueDataPacket(&room.DataPacket{Type: dataType, Payload: fullPayload})
+	default:
+		// the messages of a larger write are queued all or none, so the
+		// peer never gets a part of a failed write
+		sDataPackets := make([]*room.DataPacket, 0, (fullPldSize+C.CLIVEKIT_SIZE_MESSAGE-1)/C.CLIVEKIT_SIZE_MESSAGE)
+		for i := uint64(0); i < fullPldSize; i += C.CLIVEKIT_SIZE_MESSAGE {
+			end := i + C.CLIVEKIT_SIZE_MESSAGE
+			if end > fullPldSize {
+				end = fullPldSize
+			}
+			sDataPackets = append(sDataPackets, &room.DataPacket{Type: dataType, Payload: fullPayload[i:end]})
+		}
+		err = rc.TryEnqueueDataPackets(sDataPackets)
+	}
+
+	if err != nil {
+		if errors.Is(err, room.ErrQueueFull) {
+			return C.CLIVEKIT_ETYPE_QUEUE_FULL
+		}
+		return C.CLIVEKIT_ETYPE_PUBLISH
+	}
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_enqueue_data_to_room
+func clivekit_enqueue_data_to_room(room_desc *C.char, data_type C.clivekit_data_type, data *C.char, data_size C.size_t, timeout_ms C.int) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	ctx, cancel := timeoutContext(timeout_ms)
+	defer cancel()
+
+	var (
+		fullPayload = unsafe.Slice((*byte)(unsafe.Pointer(data)), int(data_size))
+		fullPldSize = uint64(data_size)
+		dataType    = convertDataType(data_type)
+	)
+
+	// the block policy waits for free space here, up to the timeout
+	for i := uint64(0); i < fullPldSize; i += C.CLIVEKIT_SIZE_MESSAGE {
+		end := i + C.CLIVEKIT_SIZE_MESSAGE
+		if end > fullPldSize {
+			end = fullPldSize
+		}
+		err := rc.EnqueueDataPacket(ctx, &room.DataPacket{Type: dataType, Payload: fullPayload[i:end]})
+		if err != nil {
+			if errors.Is(err, room.ErrQueueFull) || ctx.Err() != nil {
+				return C.CLIVEKIT_ETYPE_QUEUE_FULL
+			}
+			return C.CLIVEKIT_ETYPE_PUBLISH
+		}
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_publish_audio_track
+func clivekit_publish_audio_track(room_desc *C.char, format C.clivekit_audio_format, bitrate C.uint32_t) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	if err := rc.PublishAudioTrack(convertAudioFormat(format), int(bitrate)); err != nil {
+		return C.CLIVEKIT_ETYPE_TRACK
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_write_audio_frames
+func clivekit_write_audio_frames(room_desc *C.char, pcm unsafe.Pointer, frames C.size_t) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	format, ok := rc.GetAudioTrackFormat()
+	if !ok {
+		return C.CLIVEKIT_ETYPE_TRACK
+	}
+
+	samples := unsafe.Slice((*byte)(pcm), int(frames)*format.FrameSize())
+	if err := rc.WriteAudioFrames(samples); err != nil {
+		return C.CLIVEKIT_ETYPE_PUBLISH
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_unpublish_audio_track
+func clivekit_unpublish_audio_track(room_desc *C.char) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	if err := rc.UnpublishAudioTrack(); err != nil {
+		return C.CLIVEKIT_ETYPE_TRACK
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_subscribe_audio
+func clivekit_subscribe_audio(room_desc *C.char, format C.clivekit_audio_format) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	if err := rc.SubscribeAudio(convertAudioFormat(format), false); err != nil {
+		return C.CLIVEKIT_ETYPE_TRACK
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_subscribe_audio_playout
+func clivekit_subscribe_audio_playout(room_desc *C.char, format C.clivekit_audio_format) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	if err := rc.SubscribeAudio(convertAudioFormat(format), true); err != nil {
+		return C.CLIVEKIT_ETYPE_TRACK
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_audio_pull
+func clivekit_audio_pull(room_desc *C.char, ident *C.char, frames C.size_t, out unsafe.Pointer) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	format, ok := rc.GetAudioSubscription()
+	if !ok {
+		return C.CLIVEKIT_ETYPE_TRACK
+	}
+
+	samples := unsafe.Slice((*byte)(out), int(frames)*format.FrameSize())
+	if _, ok := rc.PullAudio(C.GoString(ident), samples); !ok {
+		return C.CLIVEKIT_ETYPE_NO_DATA
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_write_audio_data
+func clivekit_write_audio_data(room_desc *C.char, format C.clivekit_audio_format, pcm unsafe.Pointer, frames C.size_t) C.clivekit_error_type {
+	ctx := context.Background()
+
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	audioFormat := convertAudioFormat(format)
+	samples := unsafe.Slice((*byte)(pcm), int(frames)*audioFormat.FrameSize())
+	if err := rc.EnqueueAudioData(ctx, audioFormat, samples); err != nil {
+		switch {
+		case errors.Is(err, room.ErrQueueFull):
+			return C.CLIVEKIT_ETYPE_QUEUE_FULL
+		case errors.Is(err, audio.ErrFormat):
+			return C.CLIVEKIT_ETYPE_FORMAT
+		}
+		return C.CLIVEKIT_ETYPE_PUBLISH
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_publish_video_track
+func clivekit_publish_video_track(room_desc *C.char, format C.clivekit_video_format) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	videoFormat := room.VideoFormat{
+		Width:  int(format.width),
+		Height: int(format.height),
+	}
+	if err := rc.PublishVideoTrack(videoFormat); err != nil {
+		return C.CLIVEKIT_ETYPE_TRACK
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_write_video_frame
+func clivekit_write_video_frame(room_desc *C.char, data *C.char, data_size C.size_t, timestamp_us C.uint64_t) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	var (
+		accessUnit = unsafe.Slice((*byte)(unsafe.Pointer(data)), int(data_size))
+		timestamp  = time.Duration(timestamp_us) * time.Microsecond
+	)
+	if err := rc.WriteVideoFrame(accessUnit, timestamp); err != nil {
+		if errors.Is(err, room.ErrNoTrack) {
+			return C.CLIVEKIT_ETYPE_TRACK
+		}
+		return C.CLIVEKIT_ETYPE_PUBLISH
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_unpublish_video_track
+func clivekit_unpublish_video_track(room_desc *C.char) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	if err := rc.UnpublishVideoTrack(); err != nil {
+		return C.CLIVEKIT_ETYPE_TRACK
+	}
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_subscribe_video
+func clivekit_subscribe_video(room_desc *C.char, enabled C.int) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	rc.SubscribeVideo(enabled != 0)
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_set_send_policy_for_room
+func clivekit_set_send_policy_for_room(room_desc *C.char, data_type C.clivekit_data_type, policy C.clivekit_queue_policy) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	rc.SetSendPolicy(convertDataType(data_type), convertQueuePolicy(policy))
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_get_send_queue_state
+func clivekit_get_send_queue_state(room_desc *C.char, queue_state *C.clivekit_send_queue_state) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	state := rc.GetSendQueueState()
+	queue_state.length = C.size_t(state.Length)
+	queue_state.capacity = C.size_t(state.Capacity)
+	queue_state.bytes = C.size_t(state.Bytes)
+	queue_state.dropped = C.uint64_t(state.Dropped)
+	queue_state.failed = C.uint64_t(state.Failed)
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_get_room_stats
+func clivekit_get_room_stats(room_desc *C.char, room_stats *C.clivekit_room_stats) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	stats := rc.GetStats()
+	for i := C.clivekit_data_type(0); i < C.CLIVEKIT_SIZE_DTYPES; i++ {
+		t := convertDataType(i)
+		room_stats.packets_in[i] = C.uint64_t(stats.PacketsIn[t])
+		room_stats.bytes_in[i] = C.uint64_t(stats.BytesIn[t])
+		room_stats.packets_out[i] = C.uint64_t(stats.PacketsOut[t])
+		room_stats.bytes_out[i] = C.uint64_t(stats.BytesOut[t])
+	}
+	for i := C.clivekit_drop_reason(0); i < C.CLIVEKIT_SIZE_DROPS; i++ {
+		room_stats.drops[i] = C.uint64_t(stats.Drops[convertDropReason(i)])
+	}
+	room_stats.queue_length = C.size_t(stats.QueueLength)
+	room_stats.queue_high_water = C.size_t(stats.QueueHighWater)
+	room_stats.queue_bytes = C.size_t(stats.QueueBytes)
+	for i := 0; i < C.CLIVEKIT_SIZE_LATENCY; i++ {
+		room_stats.encrypt_latency[i] = C.uint64_t(stats.EncryptLatency[i])
+		room_stats.decrypt_latency[i] = C.uint64_t(stats.DecryptLatency[i])
+	}
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_set_callback_for_room
+func clivekit_set_callback_for_room(room_desc *C.char, callback C.clivekit_data_callback, user_data unsafe.Pointer) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	handler := newDataHandler(callback, user_data)
+	for _, dataType := range []room.DataType{
+		room.CustomDataType,
+		room.TextDataType,
+		room.SignalDataType,
+		room.AudioDataType,
+		room.VideoDataType,
+	} {
+		rc.SetDataHandler(dataType, handler)
+	}
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_set_compression_for_room
+func clivekit_set_compression_for_room(room_desc *C.char, data_type C.clivekit_data_type, compression C.clivekit_compression) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	if err := rc.SetCompression(convertDataType(data_type), convertCompression(compression)); err != nil {
+		return C.CLIVEKIT_ETYPE_COMPRESS
+	}
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_set_subscription_for_room
+func clivekit_set_subscription_for_room(room_desc *C.char, dtype_mask C.uint32_t, idents **C.char, idents_count C.size_t) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	types := room.DataTypeMask(0)
+	for i := C.clivekit_data_type(0); i < C.CLIVEKIT_SIZE_DTYPES; i++ {
+		if dtype_mask&(1<<i) != 0 {
+			types |= 1 << convertDataType(i)
+		}
+	}
+	rc.SetSubscription(types, convertStrings(idents, idents_count))
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+//export clivekit_set_type_callback_for_room
+func clivekit_set_type_callback_for_room(room_desc *C.char, data_type C.clivekit_data_type, callback C.clivekit_data_callback, user_data unsafe.Pointer) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	rc.SetDataHandler(convertDataType(data_type), newDataHandler(callback, user_data))
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+// newDataHandler wraps the C callback. Handlers of a room run one at a time
+// on its delivery thread, so one packet struct is reused for every call.
+func newDataHandler(callback C.clivekit_data_callback, userData unsafe.Pointer) room.DataHandler {
+	if callback == nil {
+		return nil
+	}
+	packet := new(C.clivekit_borrowed_packet)
+	return func(dp *room.DataPacket) {
+		fillBorrowedPacket(packet, dp)
+		invokeDataCallback(unsafe.Pointer(callback), unsafe.Pointer(packet), userData)
+	}
+}
+
+func readDataPacket(room_desc *C.char, data_packet *C.clivekit_data_packet, timeout_ms C.int) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	ctx, cancel := timeoutContext(timeout_ms)
+	defer cancel()
+
+	var tds [1]*room.DataPacket
+	if _, err := rc.ReceiveDataPackets(ctx, tds[:], C.CLIVEKIT_SIZE_BUFFER); err != nil {
+		return receiveErrorType(err)
+	}
+
+	copyDataPacket(data_packet, tds[0])
+	tds[0].Release()
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+func readBorrowedPacket(room_desc *C.char, borrowed_packet *C.clivekit_borrowed_packet, timeout_ms C.int) C.clivekit_error_type {
+	rc, ok := getRoomContextByDesc(room_desc)
+	if !ok {
+		return C.CLIVEKIT_ETYPE_GET_ROOM
+	}
+
+	ctx, cancel := timeoutContext(timeout_ms)
+	defer cancel()
+
+	td, err := rc.ReceiveDataPacket(ctx)
+	if err != nil {
+		return receiveErrorType(err)
+	}
+
+	fillBorrowedPacket(borrowed_packet, td)
+
+	buffer, ok := td.Detach()
+	if !ok {
+		td.Release()
+		return C.CLIVEKIT_ETYPE_RECEIVE
+	}
+
+	handle, ok := buffer.Lend()
+	if !ok {
+		borrowed_packet.payload = nil
+		borrowed_packet.payload_size = 0
+		buffer.Release()
+		return C.CLIVEKIT_ETYPE_RECEIVE
+	}
+	borrowed_packet.handle = C.uintptr_t(handle)
+
+	return C.CLIVEKIT_ETYPE_SUCCESS
+}
+
+// timeoutContext maps the timeout convention of the C API (< 0 waits
+// forever, 0 only polls) to a context.
+func timeoutContext(timeout_ms C.int) (context.Context, context.CancelFunc) {
+	switch {
+	case timeout_ms < 0:
+		return context.Background(), func() {}
+	case timeout_ms == 0:
+		return expiredCtx, func() {}
+	}
+	return context.WithTimeout(context.Background(), time.Duration(timeout_ms)*time.Millisecond)
+}
+
+func receiveErrorType(err error) C.clivekit_error_type {
+	if errors.Is(err, context.DeadlineExceeded) {
+		return C.CLIVEKIT_ETYPE_NO_DATA
+	}
+	return C.CLIVEKIT_ETYPE_RECEIVE
+}
+
+// fillBorrowedPacket points the packet to the payload of dataPacket without
+// transferring the ownership of the buffer.
+func fillBorrowedPacket(cBorrowedPacket *C.clivekit_borrowed_packet, dataPacket *room.DataPacket) {
+	cIdent := unsafe.Slice((*byte)(unsafe.Pointer(&cBorrowedPacket.ident[0])), C.CLIVEKIT_SIZE_IDENT)
+	cIdent[copy(cIdent[:C.CLIVEKIT_SIZE_IDENT-1], dataPacket.Ident)] = 0
+
+	cBorrowedPacket.dtype = C.clivekit_data_type(dataPacket.Type)
+	cBorrowedPacket.payload = (*C.char)(unsafe.Pointer(unsafe.SliceData(dataPacket.Payload)))
+	cBorrowedPacket.payload_size = C.size_t(len(dataPacket.Payload))
+	cBorrowedPacket.handle = 0
+}
+
+func copyDataPacket(cDataPacket *C.clivekit_data_packet, dataPacket *room.DataPacket) {
+	cIdent := unsafe.Slice((*byte)(unsafe.Pointer(&cDataPacket.ident[0])), C.CLIVEKIT_SIZE_IDENT)
+	cIdent[copy(cIdent[:C.CLIVEKIT_SIZE_IDENT-1], dataPacket.Ident)] = 0
+
+	cPayload := unsafe.Slice((*byte)(unsafe.Pointer(&cDataPacket.payload[0])), C.CLIVEKIT_SIZE_BUFFER)
+	cDataPacket.payload_size = C.size_t(copy(cPayload, dataPacket.Payload))
+	cDataPacket.dtype = C.clivekit_data_type(dataPacket.Type)
+}
+
+func convertStrings(strs **C.char, count C.size_t) []string {
+	if count == 0 {
+		return nil
+	}
+	result := make([]string, 0, int(count))
+	for _, str := range unsafe.Slice(strs, int(count)) {
+		result = append(result, C.GoString(str))
+	}
+	return result
+}
+
+func convertRuntimeConfig(runtime_config *C.clivekit_runtime_config, config *tuning.Config) {
+	runtime_config.max_procs = C.int(config.MaxProcs)
+	runtime_config.gc_percent = C.int(config.GCPercent)
+	runtime_config.memory_limit = C.int64_t(config.MemoryLimit)
+}
+
+func convertDataType(data_type C.clivekit_data_type) room.DataType {
+	switch data_type {
+	case C.CLIVEKIT_DTYPE_CUSTOM:
+		return room.CustomDataType
+	case C.CLIVEKIT_DTYPE_TEXT:
+		return room.TextDataType
+	case C.CLIVEKIT_DTYPE_SIGNAL:
+		return room.SignalDataType
+	case C.CLIVEKIT_DTYPE_AUDIO:
+		return room.AudioDataType
+	case C.CLIVEKIT_DTYPE_VIDEO:
+		return room.VideoDataType
+	}
+	panic("unknown data type")
+}
+
+func convertCompression(compression C.clivekit_compression) compress.Codec {
+	switch compression {
+	case C.CLIVEKIT_COMPRESS_NONE:
+		return compress.NoCodec
+	case C.CLIVEKIT_COMPRESS_S2:
+		return compress.S2Codec
+	case C.CLIVEKIT_COMPRESS_ZSTD:
+		return compress.ZstdCodec
+	}
+	panic("unknown compression")
+}
+
+func convertQueuePolicy(policy C.clivekit_queue_policy) room.QueuePolicy {
+	switch policy {
+	case C.CLIVEKIT_POLICY_BLOCK:
+		return room.BlockQueuePolicy
+	case C.CLIVEKIT_POLICY_DROP_OLDEST:
+		return room.DropOldestQueuePolicy
+	case C.CLIVEKIT_POLICY_DROP_NEWEST:
+		return room.DropNewestQueuePolicy
+	}
+	panic("unknown queue policy")
+}
+
+func convertAudioFormat(format C.clivekit_audio_format) room.AudioFormat {
+	return room.AudioFormat{
+		SampleRate:   int(format.sample_rate),
+		Channels:     int(format.channels),
+		SampleFormat: convertSampleFormat(format.sample_format),
+	}
+}
+
+func convertLoopbackConfig(config *C.clivekit_loopback_config) loopback.Impairment {
+	return loopback.Impairment{
+		Latency:   time.Duration(config.latency_us) * time.Microsecond,
+		Jitter:    time.Duration(config.jitter_us) * time.Microsecond,
+		Loss:      float64(config.loss),
+		Reorder:   float64(config.reorder),
+		Bandwidth: int(config.bandwidth),
+		Seed:      uint64(config.seed),
+	}
+}
+
+func convertSampleFormat(format C.clivekit_sample_format) audio.SampleFormat {
+	switch format {
+	case C.CLIVEKIT_SAMPLE_F32:
+		return audio.F32
+	case C.CLIVEKIT_SAMPLE_S16:
+		return audio.S16
+	case C.CLIVEKIT_SAMPLE_S24:
+		return audio.S24
+	case C.CLIVEKIT_SAMPLE_S32:
+		return audio.S32
+	case C.CLIVEKIT_SAMPLE_F64:
+		return audio.F64
+	}
+	panic("unknown sample format")
+}
+
+func convertDropReason(reason C.clivekit_drop_reason) room.DropReason {
+	switch reason {
+	case C.CLIVEKIT_DROP_NOT_USER_DATA:
+		return room.NotUserDataDropReason
+	case C.CLIVEKIT_DROP_UNKNOWN_KEY:
+		return room.UnknownKeyDropReason
+	case C.CLIVEKIT_DROP_DECRYPT:
+		return room.DecryptDropReason
+	case C.CLIVEKIT_DROP_BAD_FRAME:
+		return room.BadFrameDropReason
+	case C.CLIVEKIT_DROP_OVERSIZE:
+		return room.OversizeDropReason
+	case C.CLIVEKIT_DROP_NO_BUFFER:
+		return room.NoBufferDropReason
+	case C.CLIVEKIT_DROP_INCOMPLETE:
+		return room.IncompleteDropReason
+	case C.CLIVEKIT_DROP_QUEUE_FULL:
+		return room.QueueFullDropReason
+	case C.CLIVEKIT_DROP_HANDLER_BUSY:
+		return room.HandlerBusyDropReason
+	case C.CLIVEKIT_DROP_CLOSED:
+		return room.ClosedDropReason
+	case C.CLIVEKIT_DROP_LATE:
+		return room.LateDropReason
+	case C.CLIVEKIT_DROP_UNSUBSCRIBED:
+		return room.UnsubscribedDropReason
+	case C.CLIVEKIT_DROP_DECRYPT_BACKLOG:
+		return room.DecryptBacklogDropReason
+	}
+	panic("unknown drop reason")
+}
+
+func convertRecvQueues(configs *[C.CLIVEKIT_SIZE_DTYPES]C.clivekit_recv_queue_config) []room.RecvQueueConfig {
+	recvQueues := make([]room.RecvQueueConfig, C.CLIVEKIT_SIZE_DTYPES)
+	for i, cfg := range configs {
+		recvQueues[convertDataType(C.clivekit_data_type(i))] = room.RecvQueueConfig{
+			Depth:  int(cfg.depth),
+			Policy: convertQueuePolicy(cfg.policy),
+			Weight: int(cfg.weight),
+		}
+	}
+	return recvQueues
+}
+
+// cAllocator places received payloads in C memory, so that they can be lent
+// to the caller without copying.
+type cAllocator struct{}
+
+func (cAllocator) Alloc(n int) []byte {
+	ptr := C.malloc(C.size_t(n))
+	if ptr == nil {
+		return nil
+	}
+	return unsafe.Slice((*byte)(ptr), n)
+}
+
+func (cAllocator) Free(b []byte) {
+	C.free(unsafe.Pointer(&b[:1][0]))
+}
+
+func createRoomContext(cRoomDesc *C.char, room room.ISecureRoom) bool {
+	return roomManager.Add(loadRoomDesc(cRoomDesc), room)
+}
+
+func getRoomContextByDesc(cRoomDesc *C.char) (room.ISecureRoom, bool) {
+	v, ok := roomManager.Get(loadRoomDesc(cRoomDesc))
+	if !ok {
+		return nil, false
+	}
+	rc, ok := v.(room.ISecureRoom)
+	return rc, ok
+}
+
+func closeRoomContextByDesc(cRoomDesc *C.char) bool {
+	// closing waits for the running callbacks to return
+	if inDataCallback() {
+		return false
+	}
+
+	v, ok := roomManager.Del(loadRoomDesc(cRoomDesc))
+	if !ok {
+		return false
+	}
+	v.Close()
+	return true
+}
+
+// loadRoomDesc views the caller's descriptor in place, without copying it.
+func loadRoomDesc(cRoomDesc *C.char) []byte {
+	return unsafe.Slice((*byte)(unsafe.Pointer(cRoomDesc)), C.CLIVEKIT_SIZE_DESC)
 }
 
 func main() {
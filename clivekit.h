@@ -21,6 +21,7 @@ typedef struct { const char *p; ptrdiff_t n; } _GoString_;
 
 #line 3 "clivekit.go"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -28,6 +29,10 @@ typedef struct { const char *p; ptrdiff_t n; } _GoString_;
 #define CLIVEKIT_SIZE_IDENT  32
 #define CLIVEKIT_SIZE_ENCKEY 32 // 256-bit key
 #define CLIVEKIT_SIZE_BUFFER 4096
+#define CLIVEKIT_SIZE_MESSAGE (1 << 16)
+#define CLIVEKIT_SIZE_DTYPES 5
+#define CLIVEKIT_SIZE_DROPS 13
+#define CLIVEKIT_SIZE_LATENCY 16 // bucket i: < (256ns << i), last: the rest
 
 typedef enum {
 	CLIVEKIT_ETYPE_SUCCESS,
@@ -36,7 +41,15 @@ typedef enum {
 	CLIVEKIT_ETYPE_GET_ROOM,
 	CLIVEKIT_ETYPE_PUBLISH,
 	CLIVEKIT_ETYPE_RECEIVE,
-	CLIVEKIT_ETYPE_CREATE_ROOM
+	CLIVEKIT_ETYPE_CREATE_ROOM,
+	CLIVEKIT_ETYPE_ACTIVATE_KEY,
+	CLIVEKIT_ETYPE_QUEUE_FULL,
+	CLIVEKIT_ETYPE_NO_DATA,
+	CLIVEKIT_ETYPE_NOTIFY,
+	CLIVEKIT_ETYPE_TRACK,
+	CLIVEKIT_ETYPE_FORMAT,
+	CLIVEKIT_ETYPE_COMPRESS,
+	CLIVEKIT_ETYPE_RUNTIME
 } clivekit_error_type;
 
 typedef enum {
@@ -47,12 +60,72 @@ typedef enum {
 	CLIVEKIT_DTYPE_VIDEO
 } clivekit_data_type;
 
+#define CLIVEKIT_DTYPE_MASK(t) (1u << (t))
+#define CLIVEKIT_DTYPE_MASK_ALL ((1u << CLIVEKIT_SIZE_DTYPES) - 1)
+
+typedef enum {
+	CLIVEKIT_POLICY_BLOCK, // clivekit_enqueue_data_to_room waits, clivekit_try_write_data_to_room returns QUEUE_FULL
+	CLIVEKIT_POLICY_DROP_OLDEST,
+	CLIVEKIT_POLICY_DROP_NEWEST
+} clivekit_queue_policy;
+
+typedef enum {
+	CLIVEKIT_COMPRESS_NONE,
+	CLIVEKIT_COMPRESS_S2,  // fast, for latency
+	CLIVEKIT_COMPRESS_ZSTD // better ratio, with the shared dictionary
+} clivekit_compression;
+
+typedef enum {
+	CLIVEKIT_STATE_CONNECTING,
+	CLIVEKIT_STATE_CONNECTED,
+	CLIVEKIT_STATE_RECONNECTING, // keys, queues and tracks are kept
+	CLIVEKIT_STATE_FAILED
+} clivekit_connect_state;
+
+typedef enum {
+	CLIVEKIT_DROP_NOT_USER_DATA,
+	CLIVEKIT_DROP_UNKNOWN_KEY,
+	CLIVEKIT_DROP_DECRYPT,
+	CLIVEKIT_DROP_BAD_FRAME,
+	CLIVEKIT_DROP_OVERSIZE,
+	CLIVEKIT_DROP_NO_BUFFER,
+	CLIVEKIT_DROP_INCOMPLETE,
+	CLIVEKIT_DROP_QUEUE_FULL,
+	CLIVEKIT_DROP_HANDLER_BUSY,
+	CLIVEKIT_DROP_CLOSED,
+	CLIVEKIT_DROP_LATE,
+	CLIVEKIT_DROP_UNSUBSCRIBED,
+	CLIVEKIT_DROP_DECRYPT_BACKLOG // frames, not messages
+} clivekit_drop_reason;
+
 typedef struct {
-	char *host;
+	size_t                depth;  // 0 = default (2048 messages)
+	clivekit_queue_policy policy; // BLOCK = default of the data type
+	unsigned              weight; // 0 for all types = strict priority
+} clivekit_recv_queue_config;
+
+typedef struct {
+	uint32_t latency_us;
+	uint32_t jitter_us; // uniform, added to the latency
+	double   loss;      // probability, lossy messages only
+	double   reorder;   // probability of a lossy message arriving late
+	uint64_t bandwidth; // bytes per second, 0 = unlimited
+	uint64_t seed;      // 0 = random
+} clivekit_loopback_config;
+
+typedef struct {
+	char *host; // "loopback://<name>" connects in process without a server
 	char *api_key;
 	char *api_secret;
 	char *room_name;
 	char *ident;
+	size_t send_queue_size; // 0 = default (256 messages)
+	size_t recv_budget;     // 0 = default (8 MiB)
+	clivekit_recv_queue_config recv_queues[CLIVEKIT_SIZE_DTYPES]; // by data type
+	clivekit_loopback_config loopback; // impairs the link of a loopback host
+	size_t compress_min_size;  // 0 = default (256 bytes)
+	const void *compress_dict; // zstd dictionary shared by the peers, may be NULL
+	size_t compress_dict_size;
 } clivekit_connect_info;
 
 typedef struct {
@@ -62,6 +135,87 @@ typedef struct {
 	size_t            payload_size;
 } clivekit_data_packet;
 
+typedef struct {
+	clivekit_data_type dtype;
+	char              ident[CLIVEKIT_SIZE_IDENT];
+	const char       *payload;
+	size_t            payload_size;
+	uintptr_t         handle;
+} clivekit_borrowed_packet;
+
+typedef enum {
+	CLIVEKIT_SAMPLE_F32, // native endian
+	CLIVEKIT_SAMPLE_S16,
+	CLIVEKIT_SAMPLE_S24, // low three bytes of 32 bits
+	CLIVEKIT_SAMPLE_S32,
+	CLIVEKIT_SAMPLE_F64
+} clivekit_sample_format;
+
+typedef struct {
+	uint32_t sample_rate;
+	uint32_t channels; // 1 or 2 for tracks, samples are interleaved
+	clivekit_sample_format sample_format;
+} clivekit_audio_format;
+
+// Conversion kernels for the PCM of audio devices, called without entering
+// Go. Integer samples are clamped. Returns -1 for an unknown format.
+extern int clivekit_convert_samples(void *dst, clivekit_sample_format dst_format, const void *src, clivekit_sample_format src_format, size_t count);
+extern void clivekit_interleave_f32(float *dst, const float *const *planes, size_t channels, size_t frames);
+extern void clivekit_deinterleave_f32(float *const *planes, const float *src, size_t channels, size_t frames);
+
+typedef struct {
+	uint32_t width;
+	uint32_t height;
+} clivekit_video_format;
+
+typedef struct {
+	const void *base;
+	size_t      len;
+} clivekit_iovec;
+
+typedef void (*clivekit_data_callback)(const clivekit_borrowed_packet *packet, void *user_data);
+
+typedef struct {
+	size_t   length;
+	size_t   capacity;
+	size_t   bytes;
+	uint64_t dropped;
+	uint64_t failed;
+} clivekit_send_queue_state;
+
+typedef struct {
+	uint64_t packets_in[CLIVEKIT_SIZE_DTYPES];  // by data type
+	uint64_t bytes_in[CLIVEKIT_SIZE_DTYPES];
+	uint64_t packets_out[CLIVEKIT_SIZE_DTYPES];
+	uint64_t bytes_out[CLIVEKIT_SIZE_DTYPES];
+	uint64_t drops[CLIVEKIT_SIZE_DROPS];        // by drop reason
+	size_t   queue_length;
+	size_t   queue_high_water;
+	size_t   queue_bytes;
+	uint64_t encrypt_latency[CLIVEKIT_SIZE_LATENCY];
+	uint64_t decrypt_latency[CLIVEKIT_SIZE_LATENCY];
+} clivekit_room_stats;
+
+typedef struct {
+	int     max_procs;    // GOMAXPROCS, 0 = keep
+	int     gc_percent;   // GOGC, 0 = keep, < 0 = off
+	int64_t memory_limit; // GOMEMLIMIT in bytes, 0 = keep, < 0 = none
+} clivekit_runtime_config;
+
+typedef struct {
+	clivekit_runtime_config config; // off settings are -1
+	uint64_t heap_bytes;  // heap objects, live or not yet swept
+	uint64_t heap_goal;   // heap size of the next collection
+	uint64_t total_bytes; // mapped by the runtime
+	uint64_t goroutines;
+	uint64_t gc_cycles;
+	uint64_t gc_pauses;   // stop-the-world pauses since the start
+	uint64_t gc_pause_p50_ns;
+	uint64_t gc_pause_p99_ns;
+	uint64_t gc_pause_p999_ns;
+	uint64_t gc_pause_max_ns;
+} clivekit_runtime_stats;
+
 
 #line 1 "cgo-generated-wrapper"
 
@@ -120,12 +274,54 @@ extern "C" {
 #endif
 
 extern clivekit_error_type clivekit_connect_to_room(char* room_desc, clivekit_connect_info conn_info);
+extern clivekit_error_type clivekit_connect_to_room_async(char* room_desc, clivekit_connect_info conn_info);
+extern clivekit_error_type clivekit_get_connect_state(char* room_desc, clivekit_connect_state* state);
+extern clivekit_error_type clivekit_drop_loopback_link(char* room_desc);
+extern clivekit_error_type clivekit_connect_to_rooms(char** room_descs, clivekit_connect_info* conn_infos, size_t count, clivekit_error_type* results);
+extern clivekit_error_type clivekit_disconnect_from_rooms(char** room_descs, size_t count, clivekit_error_type* results);
+extern void clivekit_set_decrypt_workers(size_t count);
+extern clivekit_error_type clivekit_runtime_configure(clivekit_runtime_config* config, clivekit_runtime_config* previous);
+extern void clivekit_get_runtime_stats(clivekit_runtime_stats* runtime_stats);
+extern void clivekit_set_seal_parallel_threshold(size_t size);
 extern clivekit_error_type clivekit_disconnect_from_room(char* room_desc);
 extern clivekit_error_type clivekit_add_rx_key_for_room(char* room_desc, char* ident, char* rx_key);
 extern clivekit_error_type clivekit_del_rx_key_for_room(char* room_desc, char* ident);
 extern clivekit_error_type clivekit_set_tx_key_for_room(char* room_desc, char* tx_key);
+extern clivekit_error_type clivekit_stage_rx_key_for_room(char* room_desc, char* ident, uint8_t key_id, char* rx_key);
+extern clivekit_error_type clivekit_stage_tx_key_for_room(char* room_desc, uint8_t key_id, char* tx_key);
+extern clivekit_error_type clivekit_activate_tx_key_for_room(char* room_desc, uint8_t key_id);
 extern clivekit_error_type clivekit_read_data_from_room(char* room_desc, clivekit_data_packet* data_packet);
+extern clivekit_error_type clivekit_try_read_data_from_room(char* room_desc, clivekit_data_packet* data_packet);
+extern clivekit_error_type clivekit_read_data_from_room_timeout(char* room_desc, clivekit_data_packet* data_packet, int timeout_ms);
+extern clivekit_error_type clivekit_read_borrowed_from_room(char* room_desc, clivekit_borrowed_packet* borrowed_packet);
+extern clivekit_error_type clivekit_read_borrowed_from_room_timeout(char* room_desc, clivekit_borrowed_packet* borrowed_packet, int timeout_ms);
+extern clivekit_error_type clivekit_get_room_fd(char* room_desc, int* fd);
+extern void clivekit_release_packet(clivekit_borrowed_packet* borrowed_packet);
+extern clivekit_error_type clivekit_read_batch_from_room(char* room_desc, clivekit_data_packet* data_packets, size_t max_count, size_t* count, int timeout_ms);
 extern clivekit_error_type clivekit_write_data_to_room(char* room_desc, clivekit_data_type data_type, char* data, size_t data_size);
+extern clivekit_error_type clivekit_write_datav_to_room(char* room_desc, clivekit_data_type data_type, clivekit_iovec* iov, size_t iov_count);
+extern clivekit_error_type clivekit_write_data_to_rooms(char** room_descs, size_t count, clivekit_data_type data_type, char* data, size_t data_size, clivekit_error_type* results);
+extern clivekit_error_type clivekit_write_data_to_participants(char* room_desc, char** idents, size_t idents_count, clivekit_data_type data_type, char* data, size_t data_size);
+extern clivekit_error_type clivekit_try_write_data_to_room(char* room_desc, clivekit_data_type data_type, char* data, size_t data_size);
+extern clivekit_error_type clivekit_enqueue_data_to_room(char* room_desc, clivekit_data_type data_type, char* data, size_t data_size, int timeout_ms);
+extern clivekit_error_type clivekit_publish_audio_track(char* room_desc, clivekit_audio_format format, uint32_t bitrate);
+extern clivekit_error_type clivekit_write_audio_frames(char* room_desc, void* pcm, size_t frames);
+extern clivekit_error_type clivekit_unpublish_audio_track(char* room_desc);
+extern clivekit_error_type clivekit_subscribe_audio(char* room_desc, clivekit_audio_format format);
+extern clivekit_error_type clivekit_subscribe_audio_playout(char* room_desc, clivekit_audio_format format);
+extern clivekit_error_type clivekit_audio_pull(char* room_desc, char* ident, size_t frames, void* out);
+extern clivekit_error_type clivekit_write_audio_data(char* room_desc, clivekit_audio_format format, void* pcm, size_t frames);
+extern clivekit_error_type clivekit_publish_video_track(char* room_desc, clivekit_video_format format);
+extern clivekit_error_type clivekit_write_video_frame(char* room_desc, char* data, size_t data_size, uint64_t timestamp_us);
+extern clivekit_error_type clivekit_unpublish_video_track(char* room_desc);
+extern clivekit_error_type clivekit_subscribe_video(char* room_desc, int enabled);
+extern clivekit_error_type clivekit_set_send_policy_for_room(char* room_desc, clivekit_data_type data_type, clivekit_queue_policy policy);
+extern clivekit_error_type clivekit_get_send_queue_state(char* room_desc, clivekit_send_queue_state* queue_state);
+extern clivekit_error_type clivekit_get_room_stats(char* room_desc, clivekit_room_stats* room_stats);
+extern clivekit_error_type clivekit_set_callback_for_room(char* room_desc, clivekit_data_callback callback, void* user_data);
+extern clivekit_error_type clivekit_set_compression_for_room(char* room_desc, clivekit_data_type data_type, clivekit_compression compression);
+extern clivekit_error_type clivekit_set_subscription_for_room(char* room_desc, uint32_t dtype_mask, char** idents, size_t idents_count);
+extern clivekit_error_type clivekit_set_type_callback_for_room(char* room_desc, clivekit_data_type data_type, clivekit_data_callback callback, void* user_data);
 
 #ifdef __cplusplus
 }
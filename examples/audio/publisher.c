@@ -44,6 +44,26 @@ static int min_int(int a, int b) {
     return (a < b) ? a : b;
 }
 
+// returns -1 for the formats which the library does not convert
+static int sample_format_of(enum SoundIoFormat fmt) {
+    switch (fmt) {
+    case SoundIoFormatFloat32NE: return CLIVEKIT_SAMPLE_F32;
+    case SoundIoFormatS16NE:     return CLIVEKIT_SAMPLE_S16;
+    case SoundIoFormatS24NE:     return CLIVEKIT_SAMPLE_S24;
+    case SoundIoFormatS32NE:     return CLIVEKIT_SAMPLE_S32;
+    case SoundIoFormatFloat64NE: return CLIVEKIT_SAMPLE_F64;
+    default:                     return -1;
+    }
+}
+
+static int is_interleaved(struct SoundIoChannelArea *areas, int channels, int bytes_per_sample) {
+    for (int ch = 0; ch < channels; ch += 1) {
+        if (areas[ch].ptr != areas[0].ptr + ch * bytes_per_sample || areas[ch].step != channels * bytes_per_sample)
+            return 0;
+    }
+    return 1;
+}
+
 static void read_callback(struct SoundIoInStream *instream, int frame_count_min, int frame_count_max) {
     struct RecordContext *rc = instream->userdata;
     struct SoundIoChannelArea *areas;
@@ -76,6 +96,10 @@ static void read_callback(struct SoundIoInStream *instream, int frame_count_min,
             // Due to an overflow there is a hole. Fill the ring buffer with
             // silence for the size of the hole.
             memset(write_ptr, 0, frame_count * instream->bytes_per_frame);
+            write_ptr += frame_count * instream->bytes_per_frame;
+        } else if (is_interleaved(areas, instream->layout.channel_count, instream->bytes_per_sample)) {
+            memcpy(write_ptr, areas[0].ptr, frame_count * instream->bytes_per_frame);
+            write_ptr += frame_count * instream->bytes_per_frame;
         } else {
             for (int frame = 0; frame < frame_count; frame += 1) {
                 for (int ch = 0; ch < instream->layout.channel_count; ch += 1) {
@@ -241,6 +265,23 @@ int main(int argc, char **argv) {
         return 2;
     }
 
+    // samples are sent as an Opus track, or as raw data tagged with the
+    // format when there are more channels than the track takes
+    int sample_format = sample_format_of(fmt);
+    clivekit_audio_format audio_format = {
+        .sample_rate = instream->sample_rate,
+        .channels = instream->layout.channel_count,
+        .sample_format = sample_format
+    };
+    int use_track = (sample_format >= 0) && (audio_format.channels <= 2);
+    if (use_track) {
+        status = clivekit_publish_audio_track(room_desc, audio_format, 0);
+        if (status) {
+            printf("publish track failed\n");
+            return 3;
+        }
+    }
+
     for (;;) {
         int fill_count = soundio_ring_buffer_fill_count(rc.ring_buffer);
         char *read_buf = soundio_ring_buffer_read_ptr(rc.ring_buffer);
@@ -249,8 +290,18 @@ int main(int argc, char **argv) {
             continue;
         }
 
-        int status = clivekit_write_data_to_room(room_desc, CLIVEKIT_DTYPE_AUDIO, read_buf, fill_count);
-        if (status) {
+        if (use_track) {
+            int frames = fill_count / instream->bytes_per_frame;
+            fill_count = frames * instream->bytes_per_frame;
+            status = clivekit_write_audio_frames(room_desc, read_buf, frames);
+        } else if (sample_format >= 0) {
+            int frames = fill_count / instream->bytes_per_frame;
+            fill_count = frames * instream->bytes_per_frame;
+            status = clivekit_write_audio_data(room_desc, audio_format, read_buf, frames);
+        } else {
+            status = clivekit_try_write_data_to_room(room_desc, CLIVEKIT_DTYPE_AUDIO, read_buf, fill_count);
+        }
+        if (status && status != CLIVEKIT_ETYPE_QUEUE_FULL) {
             printf("write failed\n");
             return 3;
         }
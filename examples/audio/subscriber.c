@@ -9,6 +9,8 @@
 
 struct RecordContext {
     struct SoundIoRingBuffer *ring_buffer;
+    char room_desc[CLIVEKIT_SIZE_DESC];
+    volatile int playout;
 };
 
 static enum SoundIoFormat prioritized_formats[] = {
@@ -57,9 +59,74 @@ static int min_int(int a, int b) {
     return (a < b) ? a : b;
 }
 
+// returns -1 for the formats which the library does not convert
+static int sample_format_of(enum SoundIoFormat fmt) {
+    switch (fmt) {
+    case SoundIoFormatFloat32NE: return CLIVEKIT_SAMPLE_F32;
+    case SoundIoFormatS16NE:     return CLIVEKIT_SAMPLE_S16;
+    case SoundIoFormatS24NE:     return CLIVEKIT_SAMPLE_S24;
+    case SoundIoFormatS32NE:     return CLIVEKIT_SAMPLE_S32;
+    case SoundIoFormatFloat64NE: return CLIVEKIT_SAMPLE_F64;
+    default:                     return -1;
+    }
+}
+
+static int is_interleaved(struct SoundIoChannelArea *areas, int channels, int bytes_per_sample) {
+    for (int ch = 0; ch < channels; ch += 1) {
+        if (areas[ch].ptr != areas[0].ptr + ch * bytes_per_sample || areas[ch].step != channels * bytes_per_sample)
+            return 0;
+    }
+    return 1;
+}
+
+// fills the device straight from the playout buffer of the publisher
+static void pull_callback(struct SoundIoOutStream *outstream, int frame_count_max) {
+    struct RecordContext *rc = outstream->userdata;
+    static char pcm[4096 * 2 * sizeof(double)];
+
+    struct SoundIoChannelArea *areas;
+    int channels = outstream->layout.channel_count;
+    int bytes_per_sample = outstream->bytes_per_sample;
+    int frames_left = frame_count_max;
+    int err;
+
+    while (frames_left > 0) {
+        int frame_count = min_int(frames_left, 4096);
+
+        if ((err = soundio_outstream_begin_write(outstream, &areas, &frame_count)))
+            panic("begin write error: %s", soundio_strerror(err));
+
+        if (frame_count <= 0)
+            break;
+
+        // samples come in the format of the device
+        if (is_interleaved(areas, channels, bytes_per_sample)) {
+            clivekit_audio_pull(rc->room_desc, "publisher", frame_count, areas[0].ptr);
+        } else {
+            clivekit_audio_pull(rc->room_desc, "publisher", frame_count, pcm);
+            for (int frame = 0; frame < frame_count; frame += 1) {
+                for (int ch = 0; ch < channels; ch += 1) {
+                    memcpy(areas[ch].ptr, pcm + (frame * channels + ch) * bytes_per_sample, bytes_per_sample);
+                    areas[ch].ptr += areas[ch].step;
+                }
+            }
+        }
+
+        if ((err = soundio_outstream_end_write(outstream)))
+            panic("end write error: %s", soundio_strerror(err));
+
+        frames_left -= frame_count;
+    }
+}
+
 static void write_callback(struct SoundIoOutStream *outstream, int frame_count_min, int frame_count_max) {
     struct RecordContext *rc = outstream->userdata;
 
+    if (rc->playout) {
+        pull_callback(outstream, frame_count_max);
+        return;
+    }
+
     struct SoundIoChannelArea *areas;
     int frames_left;
     int frame_count;
@@ -104,11 +171,16 @@ static void write_callback(struct SoundIoOutStream *outstream, int frame_count_m
         if (frame_count <= 0)
             break;
 
-        for (int frame = 0; frame < frame_count; frame += 1) {
-            for (int ch = 0; ch < outstream->layout.channel_count; ch += 1) {
-                memcpy(areas[ch].ptr, read_ptr, outstream->bytes_per_sample);
-                areas[ch].ptr += areas[ch].step;
-                read_ptr += outstream->bytes_per_sample;
+        if (is_interleaved(areas, outstream->layout.channel_count, outstream->bytes_per_sample)) {
+            memcpy(areas[0].ptr, read_ptr, frame_count * outstream->bytes_per_frame);
+            read_ptr += frame_count * outstream->bytes_per_frame;
+        } else {
+            for (int frame = 0; frame < frame_count; frame += 1) {
+                for (int ch = 0; ch < outstream->layout.channel_count; ch += 1) {
+                    memcpy(areas[ch].ptr, read_ptr, outstream->bytes_per_sample);
+                    areas[ch].ptr += areas[ch].step;
+                    read_ptr += outstream->bytes_per_sample;
+                }
             }
         }
 
@@ -137,7 +209,7 @@ int main(int argc, char **argv) {
     char *device_id = NULL;
     bool is_raw = false;
     char *infile = NULL;
-    struct RecordContext rc;
+    struct RecordContext rc = {0};
 
     struct SoundIo *soundio = soundio_create();
     if (!soundio) {
@@ -248,7 +320,7 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    char room_desc[CLIVEKIT_SIZE_DESC];
+    char *room_desc = rc.room_desc;
 
     clivekit_connect_info conn_info = {
         .host = "ws://localhost:7880",
@@ -273,6 +345,33 @@ int main(int argc, char **argv) {
         return 2;
     }
 
+    // play the Opus track of the publisher in the format of the device;
+    // tagged raw audio is converted to it as well
+    int sample_format = sample_format_of(fmt);
+    clivekit_audio_format audio_format = {
+        .sample_rate = outstream->sample_rate,
+        .channels = outstream->layout.channel_count,
+        .sample_format = sample_format
+    };
+    if (sample_format >= 0 && audio_format.channels > 2) {
+        status = clivekit_subscribe_audio(room_desc, audio_format);
+        if (status) {
+            printf("subscribe audio failed\n");
+            return 2;
+        }
+    }
+    if (sample_format >= 0 && audio_format.channels <= 2) {
+        status = clivekit_subscribe_audio_playout(room_desc, audio_format);
+        if (status) {
+            printf("subscribe audio failed\n");
+            return 2;
+        }
+        rc.playout = 1;
+        for (;;) {
+            soundio_wait_events(soundio);
+        }
+    }
+
     for (;;) {
         int fill_count = soundio_ring_buffer_fill_count(rc.ring_buffer);
         char *write_buf = soundio_ring_buffer_write_ptr(rc.ring_buffer);
@@ -0,0 +1,319 @@
+#include "clivekit.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Measures the per-call and per-packet cost of the library over loopback
+// rooms, so it runs without a server or network. Every result is printed
+// as one JSON object per line.
+
+#define MAX_THREADS 8
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void report(const char *name, size_t size, int threads, long ops, double elapsed_ns) {
+    double ns_per_op = elapsed_ns / ops;
+    double mb_per_s = size ? (double)size * ops / (elapsed_ns / 1e9) / 1e6 : 0;
+    printf("{\"bench\":\"%s\",\"size\":%zu,\"threads\":%d,\"ops\":%ld,\"ns_per_op\":%.1f,\"mb_per_s\":%.1f}\n",
+           name, size, threads, ops, ns_per_op, mb_per_s);
+    fflush(stdout);
+}
+
+static void connect_room(char *room_desc, const char *network, const char *ident) {
+    clivekit_connect_info conn_info = {
+        .host = (char *)network,
+        .room_name = "bench",
+        .ident = (char *)ident
+    };
+    if (clivekit_connect_to_room(room_desc, conn_info)) {
+        fprintf(stderr, "connect %s failed\n", ident);
+        exit(1);
+    }
+
+    char key[CLIVEKIT_SIZE_ENCKEY] = {0};
+    clivekit_set_tx_key_for_room(room_desc, key);
+    clivekit_add_rx_key_for_room(room_desc, "a", key);
+    clivekit_add_rx_key_for_room(room_desc, "b", key);
+}
+
+static size_t queue_length(char *room_desc) {
+    clivekit_room_stats stats;
+    clivekit_get_room_stats(room_desc, &stats);
+    return stats.queue_length;
+}
+
+// wait_queued waits up to timeout_ms for count received messages to be
+// queued and returns how many are. Dropped messages never arrive, so the
+// shortfall is reported instead of waiting for them.
+static long wait_queued(const char *name, char *room_desc, long count, int timeout_ms) {
+    double deadline = now_ns() + timeout_ms * 1e6;
+    size_t queued = queue_length(room_desc);
+    while (queued < (size_t)count && now_ns() < deadline) {
+        struct timespec pause = {0, 100000};
+        nanosleep(&pause, NULL);
+        queued = queue_length(room_desc);
+    }
+    if (queued < (size_t)count)
+        fprintf(stderr, "%s: %zu of %ld messages queued, %ld short\n", name, queued, count, count - (long)queued);
+    return queued < (size_t)count ? (long)queued : count;
+}
+
+// wait_send_drained waits up to timeout_ms for the send queue of the room
+// to be empty.
+static int wait_send_drained(const char *name, char *room_desc, int timeout_ms) {
+    double deadline = now_ns() + timeout_ms * 1e6;
+    clivekit_send_queue_state state;
+    clivekit_get_send_queue_state(room_desc, &state);
+    while (state.length != 0 && now_ns() < deadline) {
+        struct timespec pause = {0, 100000};
+        nanosleep(&pause, NULL);
+        clivekit_get_send_queue_state(room_desc, &state);
+    }
+    if (state.length != 0)
+        fprintf(stderr, "%s: send queue not drained, %zu messages left\n", name, state.length);
+    return state.length == 0;
+}
+
+/* cgo crossings */
+
+static void bench_crossings(char *room_desc) {
+    const long ops = 1000000;
+    char missing[CLIVEKIT_SIZE_DESC] = {0};
+    clivekit_send_queue_state queue_state;
+    clivekit_room_stats stats;
+    clivekit_data_packet packet;
+    float sample = 0;
+    int fd;
+    double start;
+
+    // a plain C call for reference
+    start = now_ns();
+    for (long i = 0; i < ops; i += 1)
+        clivekit_convert_samples(&sample, CLIVEKIT_SAMPLE_F32, &sample, CLIVEKIT_SAMPLE_F32, 1);
+    report("call/convert_samples", 0, 1, ops, now_ns() - start);
+
+    start = now_ns();
+    for (long i = 0; i < ops; i += 1)
+        clivekit_get_send_queue_state(missing, &queue_state);
+    report("cgo/get_room_miss", 0, 1, ops, now_ns() - start);
+
+    start = now_ns();
+    for (long i = 0; i < ops; i += 1)
+        clivekit_get_send_queue_state(room_desc, &queue_state);
+    report("cgo/get_send_queue_state", 0, 1, ops, now_ns() - start);
+
+    start = now_ns();
+    for (long i = 0; i < ops; i += 1)
+        clivekit_get_room_stats(room_desc, &stats);
+    report("cgo/get_room_stats", 0, 1, ops, now_ns() - start);
+
+    start = now_ns();
+    for (long i = 0; i < ops; i += 1)
+        clivekit_get_room_fd(room_desc, &fd);
+    report("cgo/get_room_fd", 0, 1, ops, now_ns() - start);
+
+    start = now_ns();
+    for (long i = 0; i < ops; i += 1)
+        clivekit_try_read_data_from_room(room_desc, &packet);
+    report("cgo/try_read_empty", 0, 1, ops, now_ns() - start);
+}
+
+/* calls from several threads */
+
+struct worker {
+    char *room_desc;
+    int kind;
+    long ops;
+    size_t size;
+};
+
+enum {
+    WORKER_GET_ROOM,
+    WORKER_WRITE
+};
+
+static void *run_worker(void *arg) {
+    struct worker *w = arg;
+    clivekit_send_queue_state queue_state;
+    char *data = calloc(1, w->size + 1);
+
+    for (long i = 0; i < w->ops; i += 1) {
+        switch (w->kind) {
+        case WORKER_GET_ROOM:
+            clivekit_get_send_queue_state(w->room_desc, &queue_state);
+            break;
+        case WORKER_WRITE:
+            clivekit_write_data_to_room(w->room_desc, CLIVEKIT_DTYPE_CUSTOM, data, w->size);
+            break;
+        }
+    }
+
+    free(data);
+    return NULL;
+}
+
+static void bench_threads(const char *name, char *room_desc, int kind, long ops, size_t size) {
+    pthread_t threads[MAX_THREADS];
+    struct worker workers[MAX_THREADS];
+
+    for (int n = 1; n <= MAX_THREADS; n *= 2) {
+        double start = now_ns();
+        for (int t = 0; t < n; t += 1) {
+            workers[t] = (struct worker){room_desc, kind, ops / n, size};
+            pthread_create(&threads[t], NULL, run_worker, &workers[t]);
+        }
+        for (int t = 0; t < n; t += 1)
+            pthread_join(threads[t], NULL);
+        report(name, size, n, ops / n * n, now_ns() - start);
+    }
+}
+
+/* sealing, opening and queueing by size */
+
+static const size_t sizes[] = {64, 1024, 4096, 16384, 65536};
+
+static void bench_seal(char *solo_desc) {
+    static char data[CLIVEKIT_SIZE_MESSAGE];
+
+    // a room alone in its network seals and sends to nobody
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s += 1) {
+        long ops = 20000000 / (sizes[s] + 256);
+        double start = now_ns();
+        for (long i = 0; i < ops; i += 1)
+            clivekit_write_data_to_room(solo_desc, CLIVEKIT_DTYPE_CUSTOM, data, sizes[s]);
+        report("crypto/seal", sizes[s], 1, ops, now_ns() - start);
+    }
+}
+
+static void bench_large_writes(char *solo_desc) {
+    static const size_t large_sizes[] = {16 << 10, 64 << 10, 256 << 10, 1 << 20};
+    static char data[1 << 20];
+
+    // writes split into messages of CLIVEKIT_SIZE_MESSAGE, sealed on several
+    // cores and then on the calling thread only
+    for (int serial = 0; serial < 2; serial += 1) {
+        clivekit_set_seal_parallel_threshold(serial ? SIZE_MAX : 0);
+        for (size_t s = 0; s < sizeof(large_sizes) / sizeof(large_sizes[0]); s += 1) {
+            long ops = 200000000 / large_sizes[s];
+            double start = now_ns();
+            for (long i = 0; i < ops; i += 1)
+                clivekit_write_data_to_room(solo_desc, CLIVEKIT_DTYPE_VIDEO, data, large_sizes[s]);
+            report(serial ? "room/write_large_serial" : "room/write_large", large_sizes[s], 1, ops, now_ns() - start);
+        }
+    }
+    clivekit_set_seal_parallel_threshold(0);
+}
+
+static void bench_roundtrip(char *a_desc, char *b_desc) {
+    static char data[CLIVEKIT_SIZE_MESSAGE];
+    clivekit_borrowed_packet packet;
+
+    // seal, loopback hop, open, queue and a borrowed read
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s += 1) {
+        long ops = 10000000 / (sizes[s] + 256);
+        double start = now_ns();
+        for (long i = 0; i < ops; i += 1) {
+            clivekit_write_data_to_room(a_desc, CLIVEKIT_DTYPE_TEXT, data, sizes[s]);
+            clivekit_read_borrowed_from_room(b_desc, &packet);
+            clivekit_release_packet(&packet);
+        }
+        report("room/roundtrip", sizes[s], 1, ops, now_ns() - start);
+    }
+}
+
+static void bench_queues(char *a_desc, char *b_desc, char *solo_desc) {
+    static char data[1024];
+    const long ops = 1000;
+    clivekit_data_packet packet;
+    clivekit_borrowed_packet borrowed;
+    double start;
+
+    // enqueue into the send queue in bursts until it is full; the worker of
+    // the room drains it between bursts, which is not timed
+    double spent = 0;
+    long sent = 0;
+    while (sent < 100 * ops) {
+        long burst_start = sent;
+        start = now_ns();
+        while (sent < 100 * ops &&
+               clivekit_try_write_data_to_room(solo_desc, CLIVEKIT_DTYPE_CUSTOM, data, sizeof(data)) == CLIVEKIT_ETYPE_SUCCESS)
+            sent += 1;
+        spent += now_ns() - start;
+        if (sent == burst_start) {
+            fprintf(stderr, "queue/try_write: write failed with an empty queue\n");
+            break;
+        }
+        if (!wait_send_drained("queue/try_write", solo_desc, 5000))
+            break;
+    }
+    report("queue/try_write", sizeof(data), 1, sent, spent);
+
+    // dequeue of received messages which are already queued
+    for (long i = 0; i < ops; i += 1)
+        clivekit_write_data_to_room(a_desc, CLIVEKIT_DTYPE_TEXT, data, sizeof(data));
+    long queued = wait_queued("queue/read_copy", b_desc, ops, 5000);
+    start = now_ns();
+    for (long i = 0; i < queued; i += 1)
+        clivekit_try_read_data_from_room(b_desc, &packet);
+    if (queued)
+        report("queue/read_copy", sizeof(data), 1, queued, now_ns() - start);
+
+    // the same messages read in batches, one call per batch
+    static clivekit_data_packet batch[64];
+    for (long i = 0; i < ops; i += 1)
+        clivekit_write_data_to_room(a_desc, CLIVEKIT_DTYPE_TEXT, data, sizeof(data));
+    queued = wait_queued("queue/read_batch", b_desc, ops, 5000);
+    long read = 0;
+    start = now_ns();
+    while (read < queued) {
+        size_t count = 0;
+        clivekit_read_batch_from_room(b_desc, batch, 64, &count, 0);
+        if (count == 0)
+            break;
+        read += count;
+    }
+    if (read)
+        report("queue/read_batch", sizeof(data), 1, read, now_ns() - start);
+
+    for (long i = 0; i < ops; i += 1)
+        clivekit_write_data_to_room(a_desc, CLIVEKIT_DTYPE_TEXT, data, sizeof(data));
+    queued = wait_queued("queue/read_borrowed", b_desc, ops, 5000);
+    start = now_ns();
+    for (long i = 0; i < queued; i += 1) {
+        if (clivekit_read_borrowed_from_room_timeout(b_desc, &borrowed, 0) == CLIVEKIT_ETYPE_SUCCESS)
+            clivekit_release_packet(&borrowed);
+    }
+    if (queued)
+        report("queue/read_borrowed", sizeof(data), 1, queued, now_ns() - start);
+}
+
+int main(void) {
+    char a_desc[CLIVEKIT_SIZE_DESC];
+    char b_desc[CLIVEKIT_SIZE_DESC];
+    char solo_desc[CLIVEKIT_SIZE_DESC];
+
+    connect_room(a_desc, "loopback://pair", "a");
+    connect_room(b_desc, "loopback://pair", "b");
+    connect_room(solo_desc, "loopback://solo", "a");
+
+    bench_crossings(b_desc);
+    bench_threads("room_manager/get", b_desc, WORKER_GET_ROOM, 1000000, 0);
+    bench_threads("cipher/tx_contention", solo_desc, WORKER_WRITE, 200000, 1024);
+    bench_seal(solo_desc);
+    bench_large_writes(solo_desc);
+    bench_roundtrip(a_desc, b_desc);
+    bench_queues(a_desc, b_desc, solo_desc);
+
+    clivekit_disconnect_from_room(solo_desc);
+    clivekit_disconnect_from_room(b_desc);
+    clivekit_disconnect_from_room(a_desc);
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include "clivekit.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Compares the conversion kernels of the library with the per-sample loops
+// of the audio examples: memcpy of one sample per channel and frame, and a
+// scalar conversion of each sample.
+
+#define CHANNELS 2
+#define FRAMES   960 // 20ms at 48kHz
+#define ROUNDS   20000
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// prints one JSON object per line like bench.c
+static void report(const char *name, double start) {
+    double ns = (now_ns() - start) / ((double)ROUNDS * FRAMES * CHANNELS);
+    printf("{\"bench\":\"convert/%s\",\"size\":%d,\"threads\":1,\"ops\":%d,\"ns_per_op\":%.3f,\"mb_per_s\":0}\n",
+           name, FRAMES * CHANNELS, ROUNDS * FRAMES * CHANNELS, ns);
+}
+
+// keeps the compiler from dropping the measured work
+static volatile float sink;
+
+// the loops read sizes at run time like they read the device streams
+static volatile int stream_channels = CHANNELS;
+static volatile int stream_bytes_per_sample = sizeof(float);
+
+struct area {
+    char *ptr;
+    int step;
+};
+
+int main(void) {
+    static float interleaved[FRAMES * CHANNELS];
+    static float left[FRAMES], right[FRAMES];
+    static int16_t s16[FRAMES * CHANNELS];
+    static int32_t s32[FRAMES * CHANNELS];
+    static double f64[FRAMES * CHANNELS];
+    float *planes[CHANNELS] = {left, right};
+    double start;
+
+    for (int i = 0; i < FRAMES * CHANNELS; i += 1)
+        interleaved[i] = (float)((rand() % 65536) - 32768) / 32768.0f;
+
+    int channels = stream_channels;
+    int bytes_per_sample = stream_bytes_per_sample;
+
+    // deinterleave, as write_callback copies into device areas
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r += 1) {
+        const char *read_ptr = (const char *)interleaved;
+        struct area areas[CHANNELS] = {{(char *)left, bytes_per_sample}, {(char *)right, bytes_per_sample}};
+        for (int frame = 0; frame < FRAMES; frame += 1) {
+            for (int ch = 0; ch < channels; ch += 1) {
+                memcpy(areas[ch].ptr, read_ptr, bytes_per_sample);
+                areas[ch].ptr += areas[ch].step;
+                read_ptr += bytes_per_sample;
+            }
+        }
+        sink = left[r % FRAMES];
+    }
+    report("deinterleave_loop", start);
+
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r += 1) {
+        clivekit_deinterleave_f32(planes, interleaved, CHANNELS, FRAMES);
+        sink = left[r % FRAMES];
+    }
+    report("deinterleave_kernel", start);
+
+    // interleave, as read_callback copies from device areas
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r += 1) {
+        char *write_ptr = (char *)interleaved;
+        struct area areas[CHANNELS] = {{(char *)left, bytes_per_sample}, {(char *)right, bytes_per_sample}};
+        for (int frame = 0; frame < FRAMES; frame += 1) {
+            for (int ch = 0; ch < channels; ch += 1) {
+                memcpy(write_ptr, areas[ch].ptr, bytes_per_sample);
+                areas[ch].ptr += areas[ch].step;
+                write_ptr += bytes_per_sample;
+            }
+        }
+        sink = interleaved[r % FRAMES];
+    }
+    report("interleave_loop", start);
+
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r += 1) {
+        clivekit_interleave_f32(interleaved, (const float *const *)planes, CHANNELS, FRAMES);
+        sink = interleaved[r % FRAMES];
+    }
+    report("interleave_kernel", start);
+
+    // conversion
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r += 1) {
+        for (int i = 0; i < FRAMES * CHANNELS; i += 1) {
+            float x = interleaved[i] * 32768.0f;
+            x = x < -32768.0f ? -32768.0f : (x > 32767.0f ? 32767.0f : x);
+            s16[i] = (int16_t)x;
+        }
+        sink = s16[r % FRAMES];
+    }
+    report("f32_s16_loop", start);
+
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r += 1) {
+        clivekit_convert_samples(s16, CLIVEKIT_SAMPLE_S16, interleaved, CLIVEKIT_SAMPLE_F32, FRAMES * CHANNELS);
+        sink = s16[r % FRAMES];
+    }
+    report("f32_s16_kernel", start);
+
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r += 1) {
+        for (int i = 0; i < FRAMES * CHANNELS; i += 1)
+            interleaved[i] = (float)s16[i] / 32768.0f;
+        sink = interleaved[r % FRAMES];
+    }
+    report("s16_f32_loop", start);
+
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r += 1) {
+        clivekit_convert_samples(interleaved, CLIVEKIT_SAMPLE_F32, s16, CLIVEKIT_SAMPLE_S16, FRAMES * CHANNELS);
+        sink = interleaved[r % FRAMES];
+    }
+    report("s16_f32_kernel", start);
+
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r += 1) {
+        clivekit_convert_samples(s32, CLIVEKIT_SAMPLE_S32, interleaved, CLIVEKIT_SAMPLE_F32, FRAMES * CHANNELS);
+        sink = (float)s32[r % FRAMES];
+    }
+    report("f32_s32_kernel", start);
+
+    start = now_ns();
+    for (int r = 0; r < ROUNDS; r += 1) {
+        clivekit_convert_samples(f64, CLIVEKIT_SAMPLE_F64, s32, CLIVEKIT_SAMPLE_S32, FRAMES * CHANNELS);
+        sink = (float)f64[r % FRAMES];
+    }
+    report("s32_f64_kernel", start);
+
+    return 0;
+}
@@ -1,8 +1,27 @@
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include "clivekit.h" 
 
-#define BUFF_SIZE (1 << 16)
+#define BUFF_SIZE (1 << 20)
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// finds the access unit delimiter which starts the next access unit
+static char *find_aud(char *begin, char *end) {
+    static const char aud[] = {0, 0, 0, 1, 9};
+    for (char *p = begin; p + sizeof(aud) <= end; p++) {
+        if (memcmp(p, aud, sizeof(aud)) == 0) {
+            return p;
+        }
+    }
+    return NULL;
+}
 
 int main() {
     char room_desc[CLIVEKIT_SIZE_DESC];
@@ -30,21 +49,53 @@ int main() {
         return 2;
     }
 
-    FILE *writer_pipe = fopen("writer_pipe.ts", "rb");
+    clivekit_video_format video_format = {
+        .width = 640,
+        .height = 480
+    };
+    status = clivekit_publish_video_track(room_desc, video_format);
+    if (status) {
+        printf("publish track failed\n");
+        return 3;
+    }
+
+    FILE *writer_pipe = fopen("writer_pipe.h264", "rb");
     if (writer_pipe == NULL) {
         printf("fopen\n");
         return 3;
     }
 
-    char buff[BUFF_SIZE];
+    static char buff[BUFF_SIZE];
+    size_t size = 0;
     while(1) {
-        int n = fread(buff, sizeof(char), BUFF_SIZE, writer_pipe);
-        int status = clivekit_write_data_to_room(room_desc, CLIVEKIT_DTYPE_VIDEO, buff, n);
-        if (status) {
-            printf("write failed\n");
+        size_t n = fread(buff + size, sizeof(char), BUFF_SIZE - size, writer_pipe);
+        if (n == 0) {
+            break;
+        }
+        size += n;
+
+        // every access unit starts with a delimiter (h264_metadata=aud=insert)
+        char *begin = find_aud(buff, buff + size);
+        char *next;
+        while (begin && (next = find_aud(begin + 1, buff + size))) {
+            int status = clivekit_write_video_frame(room_desc, begin, next - begin, now_us());
+            if (status) {
+                printf("write failed\n");
+                return 3;
+            }
+            begin = next;
+        }
+
+        if (begin == NULL) {
+            size = 0;
+        } else {
+            size -= begin - buff;
+            memmove(buff, begin, size);
+        }
+        if (size == BUFF_SIZE) {
+            printf("access unit too large\n");
             return 3;
         }
-        // printf("WRITE %d\n", n);
     }
 
     fclose(writer_pipe);
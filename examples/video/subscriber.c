@@ -28,15 +28,21 @@ int main() {
         return 2;
     }
 
-    FILE *reader_pipe = fopen("reader_pipe.ts", "wb");
+    status = clivekit_subscribe_video(room_desc, 1);
+    if (status) {
+        printf("subscribe video failed\n");
+        return 2;
+    }
+
+    FILE *reader_pipe = fopen("reader_pipe.h264", "wb");
     if (reader_pipe == NULL) {
         printf("fopen\n");
         return 3;
     }
 
-    clivekit_data_packet data_packet;
+    clivekit_borrowed_packet data_packet;
     while(1){
-        int status = clivekit_read_data_from_room(room_desc, &data_packet);
+        int status = clivekit_read_borrowed_from_room(room_desc, &data_packet);
         if (status) {
             printf("read failed\n");
             return 3;
@@ -44,6 +50,7 @@ int main() {
         // printf("READ %zu\n", data_packet.payload_size);
         fwrite(data_packet.payload, sizeof(char),data_packet.payload_size, reader_pipe);
         fflush(reader_pipe);
+        clivekit_release_packet(&data_packet);
     }
 
     fclose(reader_pipe);
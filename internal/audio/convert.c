@@ -0,0 +1,446 @@
+#include "convert.h"
+
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CLIVEKIT_X86 1
+#include <immintrin.h>
+#endif
+
+// Integer samples are scaled by 2^(bits-1). Floats are clamped to [-1, 1]
+// before scaling, and the upper bound maps to the largest integer. They are
+// rounded half to even, as cvtps does in the default MXCSR mode, so every
+// kernel gives the same output, and NaN becomes 0.
+
+#define S16_SCALE 32768.0f
+#define S24_SCALE 8388608.0f
+#define S32_SCALE 2147483648.0f
+#define S32_MAX_F 2147483520.0f // largest float below 2^31
+
+#define CHUNK 1024
+
+typedef void (*to_f32_fn)(float *dst, const void *src, size_t n);
+typedef void (*from_f32_fn)(void *dst, const float *src, size_t n);
+
+#if FLT_EVAL_METHOD != 0
+// the sums of roundf_i32 must be rounded to float, not kept wider
+typedef volatile float exact_float;
+#else
+typedef float exact_float;
+#endif
+
+static inline float clampf(float x, float lo, float hi) {
+	if (x != x) {
+		return 0.0f;
+	}
+	return x < lo ? lo : (x > hi ? hi : x);
+}
+
+// rounds a clamped float without libm, which the users of the archive may
+// not link: adding 2^23 leaves no fraction bits, so the sum is rounded to
+// the nearest even integer. Floats from 2^23 up are whole already.
+static inline int32_t roundf_i32(float x) {
+	exact_float t;
+	if (x >= 0.0f && x < 8388608.0f) {
+		t = x + 8388608.0f;
+		x = t - 8388608.0f;
+	} else if (x < 0.0f && x > -8388608.0f) {
+		t = x - 8388608.0f;
+		x = t + 8388608.0f;
+	}
+	return (int32_t)x;
+}
+
+/* scalar kernels, also used for the tails of the vector ones */
+
+static void s16_to_f32_scalar(float *dst, const void *src, size_t n) {
+	const int16_t *s = src;
+	for (size_t i = 0; i < n; i++) dst[i] = (float)s[i] * (1.0f / S16_SCALE);
+}
+
+static void f32_to_s16_scalar(void *dst, const float *src, size_t n) {
+	int16_t *d = dst;
+	for (size_t i = 0; i < n; i++) {
+		float x = clampf(src[i] * S16_SCALE, -S16_SCALE, S16_SCALE - 1.0f);
+		d[i] = (int16_t)roundf_i32(x);
+	}
+}
+
+// S24 is stored in the low three bytes of 32-bit words, as in libsoundio.
+static void s24_to_f32_scalar(float *dst, const void *src, size_t n) {
+	const int32_t *s = src;
+	for (size_t i = 0; i < n; i++) dst[i] = (float)((int32_t)((uint32_t)s[i] << 8) >> 8) * (1.0f / S24_SCALE);
+}
+
+static void f32_to_s24_scalar(void *dst, const float *src, size_t n) {
+	int32_t *d = dst;
+	for (size_t i = 0; i < n; i++) {
+		float x = clampf(src[i] * S24_SCALE, -S24_SCALE, S24_SCALE - 1.0f);
+		d[i] = roundf_i32(x);
+	}
+}
+
+static void s32_to_f32_scalar(float *dst, const void *src, size_t n) {
+	const int32_t *s = src;
+	for (size_t i = 0; i < n; i++) dst[i] = (float)s[i] * (1.0f / S32_SCALE);
+}
+
+static void f32_to_s32_scalar(void *dst, const float *src, size_t n) {
+	int32_t *d = dst;
+	for (size_t i = 0; i < n; i++) {
+		float x = clampf(src[i] * S32_SCALE, -S32_SCALE, S32_MAX_F);
+		d[i] = roundf_i32(x);
+	}
+}
+
+static void f64_to_f32_scalar(float *dst, const void *src, size_t n) {
+	const double *s = src;
+	for (size_t i = 0; i < n; i++) dst[i] = (float)s[i];
+}
+
+static void f32_to_f64_scalar(void *dst, const float *src, size_t n) {
+	double *d = dst;
+	for (size_t i = 0; i < n; i++) d[i] = (double)src[i];
+}
+
+#ifdef CLIVEKIT_X86
+
+/* SSE2, the baseline of x86-64, selected at run time on i386 */
+
+#define SSE2 __attribute__((target("sse2")))
+
+// clamps like clampf, the and with the ordered mask turns NaN into 0
+SSE2 static inline __m128 clamp_ps(__m128 x, __m128 lo, __m128 hi) {
+	x = _mm_and_ps(x, _mm_cmpord_ps(x, x));
+	return _mm_min_ps(_mm_max_ps(x, lo), hi);
+}
+
+SSE2 static void s16_to_f32_sse2(float *dst, const void *src, size_t n) {
+	const int16_t *s = src;
+	const __m128 scale = _mm_set1_ps(1.0f / S16_SCALE);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+	s16_to_f32_scalar(dst + i, s + i, n - i);
+}
+
+SSE2 static void f32_to_s16_sse2(void *dst, const float *src, size_t n) {
+	int16_t *d = dst;
+	const __m128 scale = _mm_set1_ps(S16_SCALE);
+	const __m128 lo_lim = _mm_set1_ps(-S16_SCALE);
+	const __m128 hi_lim = _mm_set1_ps(S16_SCALE - 1.0f);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m128 a = clamp_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), lo_lim, hi_lim);
+		__m128 b = clamp_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), lo_lim, hi_lim);
+		__m128i lo = _mm_cvtps_epi32(a);
+		__m128i hi = _mm_cvtps_epi32(b);
+		_mm_storeu_si128((__m128i *)(d + i), _mm_packs_epi32(lo, hi));
+	}
+	f32_to_s16_scalar(d + i, src + i, n - i);
+}
+
+SSE2 static void s24_to_f32_sse2(float *dst, const void *src, size_t n) {
+	const int32_t *s = src;
+	const __m128 scale = _mm_set1_ps(1.0f / S24_SCALE);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+		v = _mm_srai_epi32(_mm_slli_epi32(v, 8), 8);
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+	}
+	s24_to_f32_scalar(dst + i, s + i, n - i);
+}
+
+SSE2 static void f32_to_s24_sse2(void *dst, const float *src, size_t n) {
+	int32_t *d = dst;
+	const __m128 scale = _mm_set1_ps(S24_SCALE);
+	const __m128 lo = _mm_set1_ps(-S24_SCALE);
+	const __m128 hi = _mm_set1_ps(S24_SCALE - 1.0f);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 x = clamp_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), lo, hi);
+		_mm_storeu_si128((__m128i *)(d + i), _mm_cvtps_epi32(x));
+	}
+	f32_to_s24_scalar(d + i, src + i, n - i);
+}
+
+SSE2 static void s32_to_f32_sse2(float *dst, const void *src, size_t n) {
+	const int32_t *s = src;
+	const __m128 scale = _mm_set1_ps(1.0f / S32_SCALE);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+	}
+	s32_to_f32_scalar(dst + i, s + i, n - i);
+}
+
+SSE2 static void f32_to_s32_sse2(void *dst, const float *src, size_t n) {
+	int32_t *d = dst;
+	const __m128 scale = _mm_set1_ps(S32_SCALE);
+	const __m128 lo = _mm_set1_ps(-S32_SCALE);
+	const __m128 hi = _mm_set1_ps(S32_MAX_F);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 x = clamp_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), lo, hi);
+		_mm_storeu_si128((__m128i *)(d + i), _mm_cvtps_epi32(x));
+	}
+	f32_to_s32_scalar(d + i, src + i, n - i);
+}
+
+SSE2 static void f64_to_f32_sse2(float *dst, const void *src, size_t n) {
+	const double *s = src;
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(s + i));
+		__m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(s + i + 2));
+		_mm_storeu_ps(dst + i, _mm_movelh_ps(lo, hi));
+	}
+	f64_to_f32_scalar(dst + i, s + i, n - i);
+}
+
+SSE2 static void f32_to_f64_sse2(void *dst, const float *src, size_t n) {
+	double *d = dst;
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 v = _mm_loadu_ps(src + i);
+		_mm_storeu_pd(d + i, _mm_cvtps_pd(v));
+		_mm_storeu_pd(d + i + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+	}
+	f32_to_f64_scalar(d + i, src + i, n - i);
+}
+
+/* AVX2, selected at run time */
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256 clamp256_ps(__m256 x, __m256 lo, __m256 hi) {
+	x = _mm256_and_ps(x, _mm256_cmp_ps(x, x, _CMP_ORD_Q));
+	return _mm256_min_ps(_mm256_max_ps(x, lo), hi);
+}
+
+AVX2 static void s16_to_f32_avx2(float *dst, const void *src, size_t n) {
+	const int16_t *s = src;
+	const __m256 scale = _mm256_set1_ps(1.0f / S16_SCALE);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(s + i)));
+		__m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(s + i + 8)));
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+		_mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+	}
+	s16_to_f32_sse2(dst + i, s + i, n - i);
+}
+
+AVX2 static void f32_to_s16_avx2(void *dst, const float *src, size_t n) {
+	int16_t *d = dst;
+	const __m256 scale = _mm256_set1_ps(S16_SCALE);
+	const __m256 lo_lim = _mm256_set1_ps(-S16_SCALE);
+	const __m256 hi_lim = _mm256_set1_ps(S16_SCALE - 1.0f);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m256 a = clamp256_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale), lo_lim, hi_lim);
+		__m256 b = clamp256_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale), lo_lim, hi_lim);
+		__m256i lo = _mm256_cvtps_epi32(a);
+		__m256i hi = _mm256_cvtps_epi32(b);
+		// packs works within 128-bit lanes, permute restores the order
+		__m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xd8);
+		_mm256_storeu_si256((__m256i *)(d + i), v);
+	}
+	f32_to_s16_sse2(d + i, src + i, n - i);
+}
+
+AVX2 static void s24_to_f32_avx2(float *dst, const void *src, size_t n) {
+	const int32_t *s = src;
+	const __m256 scale = _mm256_set1_ps(1.0f / S24_SCALE);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+		v = _mm256_srai_epi32(_mm256_slli_epi32(v, 8), 8);
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+	}
+	s24_to_f32_sse2(dst + i, s + i, n - i);
+}
+
+AVX2 static void f32_to_s24_avx2(void *dst, const float *src, size_t n) {
+	int32_t *d = dst;
+	const __m256 scale = _mm256_set1_ps(S24_SCALE);
+	const __m256 lo = _mm256_set1_ps(-S24_SCALE);
+	const __m256 hi = _mm256_set1_ps(S24_SCALE - 1.0f);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 x = clamp256_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale), lo, hi);
+		_mm256_storeu_si256((__m256i *)(d + i), _mm256_cvtps_epi32(x));
+	}
+	f32_to_s24_sse2(d + i, src + i, n - i);
+}
+
+AVX2 static void s32_to_f32_avx2(float *dst, const void *src, size_t n) {
+	const int32_t *s = src;
+	const __m256 scale = _mm256_set1_ps(1.0f / S32_SCALE);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+	}
+	s32_to_f32_sse2(dst + i, s + i, n - i);
+}
+
+AVX2 static void f32_to_s32_avx2(void *dst, const float *src, size_t n) {
+	int32_t *d = dst;
+	const __m256 scale = _mm256_set1_ps(S32_SCALE);
+	const __m256 lo = _mm256_set1_ps(-S32_SCALE);
+	const __m256 hi = _mm256_set1_ps(S32_MAX_F);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 x = clamp256_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale), lo, hi);
+		_mm256_storeu_si256((__m256i *)(d + i), _mm256_cvtps_epi32(x));
+	}
+	f32_to_s32_sse2(d + i, src + i, n - i);
+}
+
+AVX2 static void f64_to_f32_avx2(float *dst, const void *src, size_t n) {
+	const double *s = src;
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(s + i));
+		__m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(s + i + 4));
+		_mm256_storeu_ps(dst + i, _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+	}
+	f64_to_f32_sse2(dst + i, s + i, n - i);
+}
+
+AVX2 static void f32_to_f64_avx2(void *dst, const float *src, size_t n) {
+	double *d = dst;
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		_mm256_storeu_pd(d + i, _mm256_cvtps_pd(_mm_loadu_ps(src + i)));
+		_mm256_storeu_pd(d + i + 4, _mm256_cvtps_pd(_mm_loadu_ps(src + i + 4)));
+	}
+	f32_to_f64_sse2(d + i, src + i, n - i);
+}
+
+SSE2 static size_t interleave2_sse2(float *dst, const float *l, const float *r, size_t frames) {
+	size_t i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		__m128 a = _mm_loadu_ps(l + i), b = _mm_loadu_ps(r + i);
+		_mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(a, b));
+		_mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(a, b));
+	}
+	return i;
+}
+
+SSE2 static size_t deinterleave2_sse2(float *l, float *r, const float *src, size_t frames) {
+	size_t i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		__m128 a = _mm_loadu_ps(src + 2 * i), b = _mm_loadu_ps(src + 2 * i + 4);
+		_mm_storeu_ps(l + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(r + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
+	return i;
+}
+
+static int have_sse2;
+
+#endif // CLIVEKIT_X86
+
+// indexed by format, the F32 entries are unused
+static to_f32_fn to_f32[] = {
+	NULL, s16_to_f32_scalar, s24_to_f32_scalar, s32_to_f32_scalar, f64_to_f32_scalar,
+};
+static from_f32_fn from_f32[] = {
+	NULL, f32_to_s16_scalar, f32_to_s24_scalar, f32_to_s32_scalar, f32_to_f64_scalar,
+};
+static const size_t sample_size[] = {4, 2, 4, 4, 8};
+
+#ifdef CLIVEKIT_X86
+__attribute__((constructor)) static void select_kernels(void) {
+	__builtin_cpu_init();
+	have_sse2 = __builtin_cpu_supports("sse2");
+	if (!have_sse2) {
+		return;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		to_f32[CLIVEKIT_CONVERT_S16] = s16_to_f32_avx2;
+		to_f32[CLIVEKIT_CONVERT_S24] = s24_to_f32_avx2;
+		to_f32[CLIVEKIT_CONVERT_S32] = s32_to_f32_avx2;
+		to_f32[CLIVEKIT_CONVERT_F64] = f64_to_f32_avx2;
+		from_f32[CLIVEKIT_CONVERT_S16] = f32_to_s16_avx2;
+		from_f32[CLIVEKIT_CONVERT_S24] = f32_to_s24_avx2;
+		from_f32[CLIVEKIT_CONVERT_S32] = f32_to_s32_avx2;
+		from_f32[CLIVEKIT_CONVERT_F64] = f32_to_f64_avx2;
+		return;
+	}
+	to_f32[CLIVEKIT_CONVERT_S16] = s16_to_f32_sse2;
+	to_f32[CLIVEKIT_CONVERT_S24] = s24_to_f32_sse2;
+	to_f32[CLIVEKIT_CONVERT_S32] = s32_to_f32_sse2;
+	to_f32[CLIVEKIT_CONVERT_F64] = f64_to_f32_sse2;
+	from_f32[CLIVEKIT_CONVERT_S16] = f32_to_s16_sse2;
+	from_f32[CLIVEKIT_CONVERT_S24] = f32_to_s24_sse2;
+	from_f32[CLIVEKIT_CONVERT_S32] = f32_to_s32_sse2;
+	from_f32[CLIVEKIT_CONVERT_F64] = f32_to_f64_sse2;
+}
+#endif
+
+// clivekit_convert_samples converts count samples and returns -1 for an
+// unknown format. Formats other than F32 go through F32 in chunks which
+// stay in L1.
+int clivekit_convert_samples(void *dst, int dst_format, const void *src, int src_format, size_t count) {
+	if (dst_format < 0 || dst_format > CLIVEKIT_CONVERT_F64 || src_format < 0 || src_format > CLIVEKIT_CONVERT_F64) {
+		return -1;
+	}
+	if (dst_format == src_format) {
+		memmove(dst, src, count * sample_size[src_format]);
+		return 0;
+	}
+	if (src_format == CLIVEKIT_CONVERT_F32) {
+		from_f32[dst_format](dst, src, count);
+		return 0;
+	}
+	if (dst_format == CLIVEKIT_CONVERT_F32) {
+		to_f32[src_format](dst, src, count);
+		return 0;
+	}
+
+	float tmp[CHUNK];
+	const char *s = src;
+	char *d = dst;
+	for (size_t i = 0; i < count; i += CHUNK) {
+		size_t n = count - i < CHUNK ? count - i : CHUNK;
+		to_f32[src_format](tmp, s + i * sample_size[src_format], n);
+		from_f32[dst_format](d + i * sample_size[dst_format], tmp, n);
+	}
+	return 0;
+}
+
+void clivekit_interleave_f32(float *dst, const float *const *planes, size_t channels, size_t frames) {
+	size_t i = 0;
+#ifdef CLIVEKIT_X86
+	if (channels == 2 && have_sse2) {
+		i = interleave2_sse2(dst, planes[0], planes[1], frames);
+	}
+#endif
+	for (; i < frames; i++) {
+		for (size_t ch = 0; ch < channels; ch++) dst[i * channels + ch] = planes[ch][i];
+	}
+}
+
+void clivekit_deinterleave_f32(float *const *planes, const float *src, size_t channels, size_t frames) {
+	size_t i = 0;
+#ifdef CLIVEKIT_X86
+	if (channels == 2 && have_sse2) {
+		i = deinterleave2_sse2(planes[0], planes[1], src, frames);
+	}
+#endif
+	for (; i < frames; i++) {
+		for (size_t ch = 0; ch < channels; ch++) planes[ch][i] = src[i * channels + ch];
+	}
+}
@@ -0,0 +1,100 @@
+package audio
+
+/*
+#include "convert.h"
+*/
+import "C"
+
+import (
+	"encoding/binary"
+	"unsafe"
+)
+
+// SampleFormat is the native-endian encoding of one PCM sample. S24 takes
+// the low three bytes of a 32-bit word.
+type SampleFormat uint8
+
+const (
+	F32 SampleFormat = iota
+	S16
+	S24
+	S32
+	F64
+
+	endSampleFormat
+)
+
+const (
+	// HeaderSize is the size of the tag in front of raw PCM sent as data.
+	HeaderSize = 8
+
+	headerMagic0 = 'C'
+	headerMagic1 = 'A'
+)
+
+var (
+	sampleSizes = [endSampleFormat]int{F32: 4, S16: 2, S24: 4, S32: 4, F64: 8}
+)
+
+func (p SampleFormat) Valid() bool {
+	return p < endSampleFormat
+}
+
+// Size returns the number of bytes of one sample.
+func (p SampleFormat) Size() int {
+	return sampleSizes[p]
+}
+
+// Header tags raw PCM, so a receiver converts it without knowing the format
+// of the sender in advance.
+type Header struct {
+	SampleFormat SampleFormat
+	Channels     int
+	SampleRate   int
+}
+
+// AppendHeader appends magic 'C' 'A', format, channels and the little
+// endian sample rate.
+func AppendHeader(dst []byte, h Header) []byte {
+	dst = append(dst, headerMagic0, headerMagic1, byte(h.SampleFormat), byte(h.Channels))
+	return binary.LittleEndian.AppendUint32(dst, uint32(h.SampleRate))
+}
+
+func ParseHeader(payload []byte) (Header, bool) {
+	if len(payload) < HeaderSize || payload[0] != headerMagic0 || payload[1] != headerMagic1 {
+		return Header{}, false
+	}
+	h := Header{
+		SampleFormat: SampleFormat(payload[2]),
+		Channels:     int(payload[3]),
+		SampleRate:   int(binary.LittleEndian.Uint32(payload[4:HeaderSize])),
+	}
+	if !h.SampleFormat.Valid() || h.Channels == 0 || h.SampleRate == 0 {
+		return Header{}, false
+	}
+	return h, true
+}
+
+// Convert converts the samples of src into dst and returns their number,
+// which is bounded by both slices. Values out of the range of an integer
+// format are clamped.
+func Convert(dst []byte, dstFormat SampleFormat, src []byte, srcFormat SampleFormat) int {
+	n := min(len(dst)/dstFormat.Size(), len(src)/srcFormat.Size())
+	if n == 0 {
+		return 0
+	}
+	C.clivekit_convert_samples(
+		unsafe.Pointer(&dst[0]), C.int(dstFormat),
+		unsafe.Pointer(&src[0]), C.int(srcFormat),
+		C.size_t(n),
+	)
+	return n
+}
+
+// Bytes views float32 samples as bytes.
+func Bytes(pcm []float32) []byte {
+	if len(pcm) == 0 {
+		return nil
+	}
+	return unsafe.Slice((*byte)(unsafe.Pointer(&pcm[0])), len(pcm)*int(unsafe.Sizeof(pcm[0])))
+}
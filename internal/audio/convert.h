@@ -0,0 +1,21 @@
+#ifndef CLIVEKIT_CONVERT_H
+#define CLIVEKIT_CONVERT_H
+
+#include <stddef.h>
+
+// sample formats, in the order of audio.SampleFormat
+enum {
+	CLIVEKIT_CONVERT_F32,
+	CLIVEKIT_CONVERT_S16,
+	CLIVEKIT_CONVERT_S24,
+	CLIVEKIT_CONVERT_S32,
+	CLIVEKIT_CONVERT_F64
+};
+
+// These are the public C functions of the library, clivekit.go declares
+// them again with clivekit_sample_format arguments.
+int clivekit_convert_samples(void *dst, int dst_format, const void *src, int src_format, size_t count);
+void clivekit_interleave_f32(float *dst, const float *const *planes, size_t channels, size_t frames);
+void clivekit_deinterleave_f32(float *const *planes, const float *src, size_t channels, size_t frames);
+
+#endif
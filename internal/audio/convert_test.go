@@ -0,0 +1,32 @@
+package audio
+
+import (
+	"encoding/binary"
+	"math"
+	"testing"
+)
+
+func TestConvertRounding(t *testing.T) {
+	var (
+		values = []float32{1.5, 2.5, -1.5, -2.5, 0.5, float32(math.NaN()), 40000}
+		want   = []int16{2, 2, -2, -2, 0, 0, math.MaxInt16}
+	)
+
+	// odd length, so samples go through the vector kernels and their
+	// scalar tails alike
+	const n = 37
+	src := make([]float32, n)
+	for i := range src {
+		src[i] = values[i%len(values)] / 32768
+	}
+	dst := make([]byte, 2*n)
+	if Convert(dst, S16, Bytes(src), F32) != n {
+		t.Fatal("count")
+	}
+	for i := 0; i < n; i++ {
+		got := int16(binary.LittleEndian.Uint16(dst[2*i:]))
+		if w := want[i%len(want)]; got != w {
+			t.Fatalf("sample %d: got %d, want %d", i, got, w)
+		}
+	}
+}
@@ -0,0 +1,12 @@
+package audio
+
+import "errors"
+
+var (
+	ErrFormat         = errors.New("audio format")
+	ErrCreateCodec    = errors.New("create codec")
+	ErrEncode         = errors.New("encode")
+	ErrDecode         = errors.New("decode")
+	ErrCreateResample = errors.New("create resampler")
+	ErrResample       = errors.New("resample")
+)
@@ -0,0 +1,25 @@
+package audio
+
+type IEncoder interface {
+	// Encode compresses one frame of FrameSize interleaved samples per
+	// channel into dst and returns the packet.
+	Encode(dst []byte, pcm []float32) ([]byte, error)
+	Close()
+}
+
+type IDecoder interface {
+	// Decode writes the interleaved samples of one packet into pcm and
+	// returns the number of samples per channel. A nil packet conceals
+	// one lost frame.
+	Decode(pcm []float32, packet []byte) (int, error)
+	// DecodeFEC recovers the frame lost before packet from the redundancy
+	// that packet carries. pcm must hold exactly the lost frame.
+	DecodeFEC(pcm []float32, packet []byte) (int, error)
+	Close()
+}
+
+type IResampler interface {
+	// Resample appends the converted interleaved samples of in to dst.
+	Resample(dst []float32, in []float32) ([]float32, error)
+	Close()
+}
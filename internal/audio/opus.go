@@ -0,0 +1,154 @@
+package audio
+
+/*
+#include <opus/opus.h>
+
+static int clivekit_opus_set_bitrate(OpusEncoder *enc, opus_int32 bitrate) {
+	return opus_encoder_ctl(enc, OPUS_SET_BITRATE(bitrate));
+}
+
+static int clivekit_opus_set_fec(OpusEncoder *enc, opus_int32 loss_perc) {
+	int err = opus_encoder_ctl(enc, OPUS_SET_INBAND_FEC(1));
+	if (err != OPUS_OK) {
+		return err;
+	}
+	return opus_encoder_ctl(enc, OPUS_SET_PACKET_LOSS_PERC(loss_perc));
+}
+*/
+// #cgo LDFLAGS: -lopus
+import "C"
+
+import (
+	"time"
+	"unsafe"
+)
+
+const (
+	// SampleRate is the rate of the Opus codec and of its RTP clock.
+	SampleRate    = 48000
+	FrameDuration = 20 * time.Millisecond
+	// FrameSize is the number of samples per channel in one frame.
+	FrameSize = SampleRate / int(time.Second/FrameDuration)
+	// MaxPacketSize is the recommended bound of one Opus packet.
+	MaxPacketSize = 4000
+	MaxChannels   = 2
+
+	expectedLossPerc = 5
+)
+
+var (
+	_ IEncoder = &opusEncoder{}
+	_ IDecoder = &opusDecoder{}
+)
+
+type opusEncoder struct {
+	enc      *C.OpusEncoder
+	channels int
+}
+
+func NewEncoder(channels, bitrate int) (IEncoder, error) {
+	if channels < 1 || channels > MaxChannels {
+		return nil, ErrFormat
+	}
+
+	var err C.int
+	enc := C.opus_encoder_create(SampleRate, C.int(channels), C.OPUS_APPLICATION_AUDIO, &err)
+	if err != C.OPUS_OK {
+		return nil, ErrCreateCodec
+	}
+	if bitrate > 0 && C.clivekit_opus_set_bitrate(enc, C.opus_int32(bitrate)) != C.OPUS_OK {
+		C.opus_encoder_destroy(enc)
+		return nil, ErrCreateCodec
+	}
+	// in-band FEC lets the receiver recover a lost frame from the next one
+	if C.clivekit_opus_set_fec(enc, expectedLossPerc) != C.OPUS_OK {
+		C.opus_encoder_destroy(enc)
+		return nil, ErrCreateCodec
+	}
+
+	return &opusEncoder{enc: enc, channels: channels}, nil
+}
+
+func (p *opusEncoder) Encode(dst []byte, pcm []float32) ([]byte, error) {
+	if len(pcm) != FrameSize*p.channels {
+		return nil, ErrFormat
+	}
+	if cap(dst) < MaxPacketSize {
+		dst = make([]byte, MaxPacketSize)
+	}
+	dst = dst[:cap(dst)]
+
+	n := C.opus_encode_float(
+		p.enc,
+		(*C.float)(unsafe.Pointer(&pcm[0])),
+		C.int(FrameSize),
+		(*C.uchar)(unsafe.Pointer(&dst[0])),
+		C.opus_int32(len(dst)),
+	)
+	if n < 0 {
+		return nil, ErrEncode
+	}
+	return dst[:n], nil
+}
+
+func (p *opusEncoder) Close() {
+	C.opus_encoder_destroy(p.enc)
+}
+
+type opusDecoder struct {
+	dec      *C.OpusDecoder
+	channels int
+}
+
+func NewDecoder(channels int) (IDecoder, error) {
+	if channels < 1 || channels > MaxChannels {
+		return nil, ErrFormat
+	}
+
+	var err C.int
+	dec := C.opus_decoder_create(SampleRate, C.int(channels), &err)
+	if err != C.OPUS_OK {
+		return nil, ErrCreateCodec
+	}
+	return &opusDecoder{dec: dec, channels: channels}, nil
+}
+
+func (p *opusDecoder) Decode(pcm []float32, packet []byte) (int, error) {
+	return p.decode(pcm, packet, 0)
+}
+
+func (p *opusDecoder) DecodeFEC(pcm []float32, packet []byte) (int, error) {
+	if len(packet) == 0 {
+		return 0, ErrDecode
+	}
+	return p.decode(pcm, packet, 1)
+}
+
+func (p *opusDecoder) decode(pcm []float32, packet []byte, fec C.int) (int, error) {
+	frameSize := len(pcm) / p.channels
+	if frameSize == 0 {
+		return 0, ErrFormat
+	}
+
+	var data *C.uchar
+	if len(packet) != 0 {
+		data = (*C.uchar)(unsafe.Pointer(&packet[0]))
+	}
+
+	n := C.opus_decode_float(
+		p.dec,
+		data,
+		C.opus_int32(len(packet)),
+		(*C.float)(unsafe.Pointer(&pcm[0])),
+		C.int(frameSize),
+		fec,
+	)
+	if n < 0 {
+		return 0, ErrDecode
+	}
+	return int(n), nil
+}
+
+func (p *opusDecoder) Close() {
+	C.opus_decoder_destroy(p.dec)
+}
@@ -0,0 +1,86 @@
+package audio
+
+/*
+#include <soxr.h>
+*/
+// #cgo LDFLAGS: -lsoxr
+import "C"
+
+import (
+	"unsafe"
+)
+
+var (
+	_ IResampler = &soxrResampler{}
+)
+
+// soxrResampler converts interleaved float samples between two rates. It
+// keeps the filter state between calls, so a stream is resampled in
+// pieces without clicks at their borders.
+type soxrResampler struct {
+	soxr     C.soxr_t
+	channels int
+	ratio    float64
+}
+
+func NewResampler(inRate, outRate, channels int) (IResampler, error) {
+	if inRate <= 0 || outRate <= 0 || channels < 1 {
+		return nil, ErrFormat
+	}
+
+	var (
+		errStr  C.soxr_error_t
+		ioSpec  = C.soxr_io_spec(C.SOXR_FLOAT32_I, C.SOXR_FLOAT32_I)
+		quality = C.soxr_quality_spec(C.SOXR_MQ, 0)
+	)
+	soxr := C.soxr_create(C.double(inRate), C.double(outRate), C.uint(channels), &errStr, &ioSpec, &quality, nil)
+	if errStr != nil {
+		return nil, ErrCreateResample
+	}
+
+	return &soxrResampler{
+		soxr:     soxr,
+		channels: channels,
+		ratio:    float64(outRate) / float64(inRate),
+	}, nil
+}
+
+func (p *soxrResampler) Resample(dst []float32, in []float32) ([]float32, error) {
+	for len(in) >= p.channels {
+		inFrames := len(in) / p.channels
+		outFrames := int(float64(inFrames)*p.ratio) + 16
+
+		offset := len(dst)
+		if need := offset + outFrames*p.channels; cap(dst) < need {
+			grown := make([]float32, offset, need)
+			copy(grown, dst)
+			dst = grown
+		}
+		out := dst[offset : offset+outFrames*p.channels]
+
+		var inDone, outDone C.size_t
+		errStr := C.soxr_process(
+			p.soxr,
+			unsafe.Pointer(&in[0]),
+			C.size_t(inFrames),
+			&inDone,
+			unsafe.Pointer(&out[0]),
+			C.size_t(outFrames),
+			&outDone,
+		)
+		if errStr != nil {
+			return dst, ErrResample
+		}
+
+		dst = dst[:offset+int(outDone)*p.channels]
+		in = in[int(inDone)*p.channels:]
+		if inDone == 0 && outDone == 0 {
+			break
+		}
+	}
+	return dst, nil
+}
+
+func (p *soxrResampler) Close() {
+	C.soxr_delete(p.soxr)
+}
@@ -0,0 +1,167 @@
+package compress
+
+import (
+	"crypto/sha256"
+	"math"
+	"runtime"
+	"sync"
+
+	"github.com/klauspost/compress/s2"
+	"github.com/klauspost/compress/zstd"
+)
+
+// Codec selects the compression of a message.
+type Codec uint8
+
+const (
+	NoCodec Codec = iota
+	// S2Codec compresses at memory speed, for latency.
+	S2Codec
+	// ZstdCodec compresses better, with a dictionary shared by the peers.
+	ZstdCodec
+
+	endCodec
+)
+
+func (p Codec) Valid() bool {
+	return p < endCodec
+}
+
+type compressorKey struct {
+	codec   Codec
+	maxSize int
+	dict    [sha256.Size]byte
+}
+
+var (
+	// compressors are safe for concurrent use and are shared by all rooms
+	// with the same codec and dictionary
+	compressorsMtx sync.Mutex
+	compressors    = make(map[compressorKey]ICompressor)
+)
+
+// Get returns the compressor of the codec with the dictionary, which is
+// used by zstd only. Decompression fails for data larger than maxSize. It
+// returns nil for NoCodec.
+func Get(codec Codec, dict []byte, maxSize int) (ICompressor, error) {
+	if !codec.Valid() {
+		return nil, ErrCodec
+	}
+	if codec == NoCodec {
+		return nil, nil
+	}
+	if codec != ZstdCodec {
+		dict = nil
+		maxSize = 0
+	}
+
+	key := compressorKey{codec: codec, maxSize: maxSize, dict: sha256.Sum256(dict)}
+
+	compressorsMtx.Lock()
+	defer compressorsMtx.Unlock()
+
+	if c, ok := compressors[key]; ok {
+		return c, nil
+	}
+
+	var c ICompressor = s2Compressor{}
+	if codec == ZstdCodec {
+		z, err := newZstdCompressor(dict, maxSize)
+		if err != nil {
+			return nil, err
+		}
+		c = z
+	}
+	compressors[key] = c
+	return c, nil
+}
+
+type s2Compressor struct{}
+
+func (s2Compressor) Codec() Codec {
+	return S2Codec
+}
+
+func (s2Compressor) Compress(dst, src []byte) []byte {
+	return s2.Encode(dst[:cap(dst)], src)
+}
+
+func (s2Compressor) DecompressedSize(src []byte) (int, error) {
+	n, err := s2.DecodedLen(src)
+	if err != nil {
+		return 0, ErrCorrupt
+	}
+	return n, nil
+}
+
+func (s2Compressor) Decompress(dst, src []byte) ([]byte, error) {
+	out, err := s2.Decode(dst[:cap(dst)], src)
+	if err != nil {
+		return nil, ErrCorrupt
+	}
+	return out, nil
+}
+
+type zstdCompressor struct {
+	encoder *zstd.Encoder
+	decoder *zstd.Decoder
+}
+
+// newZstdCompressor keeps a state per core, so that the rooms, decrypt
+// workers and parallel sealers which share the compressor do not wait for
+// each other. The decoder refuses frames which would decode to more than
+// maxSize bytes before it allocates for them.
+func newZstdCompressor(dict []byte, maxSize int) (*zstdCompressor, error) {
+	var (
+		procs   = runtime.GOMAXPROCS(0)
+		encOpts = []zstd.EOption{zstd.WithEncoderLevel(zstd.SpeedFastest), zstd.WithEncoderConcurrency(procs)}
+		decOpts = []zstd.DOption{zstd.WithDecoderConcurrency(procs)}
+	)
+	if maxSize > 0 {
+		decOpts = append(decOpts, zstd.WithDecoderMaxMemory(uint64(maxSize)))
+	}
+	if len(dict) != 0 {
+		encOpts = append(encOpts, zstd.WithEncoderDict(dict))
+		decOpts = append(decOpts, zstd.WithDecoderDicts(dict))
+	}
+
+	encoder, err := zstd.NewWriter(nil, encOpts...)
+	if err != nil {
+		return nil, ErrDictionary
+	}
+	decoder, err := zstd.NewReader(nil, decOpts...)
+	if err != nil {
+		encoder.Close()
+		return nil, ErrDictionary
+	}
+	return &zstdCompressor{encoder: encoder, decoder: decoder}, nil
+}
+
+func (p *zstdCompressor) Codec() Codec {
+	return ZstdCodec
+}
+
+func (p *zstdCompressor) Compress(dst, src []byte) []byte {
+	return p.encoder.EncodeAll(src, dst[:0])
+}
+
+// DecompressedSize needs the content size in the frame header, which
+// EncodeAll always writes.
+func (p *zstdCompressor) DecompressedSize(src []byte) (int, error) {
+	var header zstd.Header
+	if err := header.Decode(src); err != nil || !header.HasFCS {
+		return 0, ErrCorrupt
+	}
+	if header.FrameContentSize > math.MaxInt {
+		return 0, ErrCorrupt
+	}
+	return int(header.FrameContentSize), nil
+}
+
+func (p *zstdCompressor) Decompress(dst, src []byte) ([]byte, error) {
+	out, err := p.decoder.DecodeAll(src, dst[:0])
+	if err != nil {
+		return nil, ErrCorrupt
+	}
+	return out, nil
+}
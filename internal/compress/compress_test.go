@@ -0,0 +1,63 @@
+package compress
+
+import (
+	"bytes"
+	"testing"
+)
+
+func TestRoundTrip(t *testing.T) {
+	src := bytes.Repeat([]byte("clivekit compresses messages of a room "), 256)
+
+	for _, codec := range []Codec{S2Codec, ZstdCodec} {
+		c, err := Get(codec, nil, len(src))
+		if err != nil {
+			t.Fatal(err)
+		}
+		if c.Codec() != codec {
+			t.Fatalf("got codec %d, want %d", c.Codec(), codec)
+		}
+
+		compressed := c.Compress(nil, src)
+		size, err := c.DecompressedSize(compressed)
+		if err != nil || size != len(src) {
+			t.Fatalf("codec %d: decompressed size %d, %v", codec, size, err)
+		}
+		out, err := c.Decompress(make([]byte, size), compressed)
+		if err != nil || !bytes.Equal(out, src) {
+			t.Fatalf("codec %d: round trip failed, %v", codec, err)
+		}
+	}
+}
+
+func TestDecoderMaxSize(t *testing.T) {
+	const maxSize = 1 << 10
+
+	c, err := Get(ZstdCodec, nil, maxSize)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, err := c.Decompress(nil, c.Compress(nil, make([]byte, maxSize))); err != nil {
+		t.Fatal(err)
+	}
+	// a frame of more than maxSize bytes is refused, whatever the peer
+	// claims about its size
+	compressed := c.Compress(nil, make([]byte, maxSize+1))
+	if _, err := c.Decompress(make([]byte, maxSize+1), compressed); err != ErrCorrupt {
+		t.Fatalf("oversized frame: got %v, want %v", err, ErrCorrupt)
+	}
+}
+
+func TestGet(t *testing.T) {
+	if _, err := Get(endCodec, nil, 0); err != ErrCodec {
+		t.Fatal(err)
+	}
+	if c, err := Get(NoCodec, nil, 0); c != nil || err != nil {
+		t.Fatal(c, err)
+	}
+	// rooms with the same codec and dictionary share the compressor
+	a, _ := Get(ZstdCodec, []byte{}, 1<<10)
+	b, _ := Get(ZstdCodec, nil, 1<<10)
+	if a != b {
+		t.Fatal("compressor not shared")
+	}
+}
@@ -0,0 +1,9 @@
+package compress
+
+import "errors"
+
+var (
+	ErrCodec      = errors.New("unknown codec")
+	ErrDictionary = errors.New("invalid dictionary")
+	ErrCorrupt    = errors.New("corrupt compressed data")
+)
@@ -0,0 +1,14 @@
+package compress
+
+type ICompressor interface {
+	Codec() Codec
+	// Compress writes the compressed src into the memory of dst when it
+	// is large enough and returns it.
+	Compress(dst, src []byte) []byte
+	// DecompressedSize reads the size of the decompressed data from the
+	// header of src.
+	DecompressedSize(src []byte) (int, error)
+	// Decompress writes the decompressed src into the memory of dst, which
+	// must hold DecompressedSize bytes.
+	Decompress(dst, src []byte) ([]byte, error)
+}
@@ -4,12 +4,43 @@ import (
 	"crypto/aes"
 	"crypto/cipher"
 	"crypto/rand"
-	"fmt"
+	"crypto/sha256"
+	"encoding/binary"
+	"errors"
 	"io"
+	"sync/atomic"
 )
 
+const (
+	// nonce = random prefix of the cipher || monotonic counter. Ciphers
+	// of the same key (rooms sharing a tx key, restarts, re-installs) draw
+	// 64-bit prefixes, so their nonces collide only after about 2^32
+	// instances.
+	noncePrefixSize  = 8
+	nonceCounterSize = 4
+	nonceSize        = noncePrefixSize + nonceCounterSize
+
+	// maxSealCount bounds the number of messages sealed by one cipher.
+	// After that the key must be rotated.
+	maxSealCount = 1<<(8*nonceCounterSize) - 1
+
+	fingerprintDomain = "clivekit key fingerprint"
+)
+
+var (
+	ErrCiphertextSize = errors.New("ciphertext too short")
+	ErrKeyExhausted   = errors.New("key usage limit exceeded")
+)
+
+// Fingerprint identifies the key of a cipher without revealing it, so
+// that ciphers created from the same key can be told apart from others.
+type Fingerprint [16]byte
+
 type sCipher struct {
-	block cipher.Block
+	aead        cipher.AEAD
+	prefix      [noncePrefixSize]byte
+	counter     atomic.Uint64
+	fingerprint Fingerprint
 }
 
 func NewCipher(key []byte) ICipher {
@@ -17,37 +48,68 @@ func NewCipher(key []byte) ICipher {
 	if err != nil {
 		panic(err)
 	}
-	return &sCipher{block}
+	aead, err := cipher.NewGCM(block)
+	if err != nil {
+		panic(err)
+	}
+	c := &sCipher{aead: aead}
+	hash := sha256.Sum256(append([]byte(fingerprintDomain), key...))
+	copy(c.fingerprint[:], hash[:])
+	if _, err := io.ReadFull(rand.Reader, c.prefix[:]); err != nil {
+		panic(err)
+	}
+	return c
+}
+
+func (p *sCipher) Fingerprint() Fingerprint {
+	return p.fingerprint
+}
+
+func (p *sCipher) NonceSize() int {
+	return nonceSize
+}
+
+func (p *sCipher) Overhead() int {
+	return nonceSize + p.aead.Overhead()
 }
 
 func (p *sCipher) Encrypt(plaintext []byte) ([]byte, error) {
-	gcm, err := cipher.NewGCM(p.block)
-	if err != nil {
-		return nil, err
+	return p.EncryptTo(nil, plaintext)
+}
+
+// EncryptTo seals the plaintext into dst[:0], reusing the memory of dst
+// when it is large enough. The nonce is prepended to the ciphertext. To seal
+// in place, put the plaintext at offset NonceSize() of the memory of dst.
+func (p *sCipher) EncryptTo(dst, plaintext []byte) ([]byte, error) {
+	counter := p.counter.Add(1)
+	if counter > maxSealCount {
+		return nil, ErrKeyExhausted
 	}
 
-	nonce := make([]byte, gcm.NonceSize())
-	if _, err = io.ReadFull(rand.Reader, nonce); err != nil {
-		return nil, err
+	size := len(plaintext) + p.Overhead()
+	out := dst[:0]
+	if cap(out) < size {
+		out = make([]byte, 0, size)
 	}
 
-	ciphertext := gcm.Seal(nonce, nonce, plaintext, nil) // nonce is prepended to ciphertext
-	return ciphertext, nil
+	out = append(out, p.prefix[:]...)
+	out = binary.BigEndian.AppendUint32(out, uint32(counter))
+	return p.aead.Seal(out, out[:nonceSize], plaintext, nil), nil
 }
 
 func (p *sCipher) Decrypt(ciphertext []byte) ([]byte, error) {
-	gcm, err := cipher.NewGCM(p.block)
-	if err != nil {
-		return nil, err
-	}
+	return p.DecryptTo(nil, ciphertext)
+}
 
-	nonceSize := gcm.NonceSize()
-	if len(ciphertext) < nonceSize {
-		return nil, fmt.Errorf("ciphertext too short")
+// DecryptTo opens the ciphertext into dst[:0], reusing the memory of dst
+// when it is large enough.
+func (p *sCipher) DecryptTo(dst, ciphertext []byte) ([]byte, error) {
+	if len(ciphertext) < p.Overhead() {
+		return nil, ErrCiphertextSize
 	}
 
 	nonce, encryptedData := ciphertext[:nonceSize], ciphertext[nonceSize:]
-	plaintext, err := gcm.Open(nil, nonce, encryptedData, nil)
+	plaintext, err := p.aead.Open(dst[:0], nonce, encryptedData, nil)
 	if err != nil {
 		return nil, err
 	}
@@ -2,50 +2,131 @@ package crypto
 
 import (
 	"sync"
+	"sync/atomic"
 )
 
+const (
+	// maxEpochs bounds the number of keys kept per sender. Staging one
+	// more key evicts the oldest one.
+	maxEpochs = 4
+)
+
+type epoch struct {
+	id     uint8
+	cipher ICipher
+}
+
+// keyring is an immutable snapshot of all keys of the room. Writers build
+// a new snapshot and swap it atomically, readers never lock.
+type keyring struct {
+	tx       epoch
+	hasTX    bool
+	txStaged []epoch
+	rxs      map[string][]epoch
+}
+
 type cipherManager struct {
-	mtx *sync.RWMutex
-	tx  ICipher
-	rxs map[string]ICipher
+	mtx  *sync.Mutex
+	ring atomic.Pointer[keyring]
 }
 
 func NewCipherManager() ICipherManager {
-	return &cipherManager{
-		mtx: &sync.RWMutex{},
-		rxs: make(map[string]ICipher, 64),
-	}
+	p := &cipherManager{mtx: &sync.Mutex{}}
+	p.ring.Store(&keyring{rxs: make(map[string][]epoch, 64)})
+	return p
 }
 
 func (p *cipherManager) SetTX(v ICipher) {
-	p.mtx.Lock()
-	p.tx = v
-	p.mtx.Unlock()
+	p.update(func(r *keyring) {
+		r.txStaged = stageEpoch(r.txStaged, epoch{0, v})
+		r.activateTX(0)
+	})
+}
+
+func (p *cipherManager) StageTX(id uint8, v ICipher) {
+	p.update(func(r *keyring) {
+		r.txStaged = stageEpoch(r.txStaged, epoch{id, v})
+	})
+}
+
+func (p *cipherManager) ActivateTX(id uint8) bool {
+	ok := false
+	p.update(func(r *keyring) {
+		ok = r.activateTX(id)
+	})
+	return ok
 }
 
 func (p *cipherManager) AddRX(k string, v ICipher) {
-	p.mtx.Lock()
-	p.rxs[k] = v
-	p.mtx.Unlock()
+	p.StageRX(k, 0, v)
+}
+
+func (p *cipherManager) StageRX(k string, id uint8, v ICipher) {
+	p.update(func(r *keyring) {
+		r.rxs[k] = stageEpoch(r.rxs[k], epoch{id, v})
+	})
 }
 
 func (p *cipherManager) DelRX(k string) {
-	p.mtx.Lock()
-	delete(p.rxs, k)
-	p.mtx.Unlock()
+	p.update(func(r *keyring) {
+		delete(r.rxs, k)
+	})
+}
+
+func (p *cipherManager) GetTX() (uint8, ICipher, bool) {
+	r := p.ring.Load()
+	return r.tx.id, r.tx.cipher, r.hasTX
 }
 
-func (p *cipherManager) GetTX() (ICipher, bool) {
-	p.mtx.RLock()
-	defer p.mtx.RUnlock()
+func (p *cipherManager) GetRX(k string, id uint8) (ICipher, bool) {
+	for _, e := range p.ring.Load().rxs[k] {
+		if e.id == id {
+			return e.cipher, true
+		}
+	}
+	return nil, false
+}
+
+func (p *cipherManager) update(f func(*keyring)) {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	old := p.ring.Load()
+	r := &keyring{
+		tx:       old.tx,
+		hasTX:    old.hasTX,
+		txStaged: old.txStaged,
+		rxs:      make(map[string][]epoch, len(old.rxs)),
+	}
+	for k, v := range old.rxs {
+		r.rxs[k] = v
+	}
 
-	return p.tx, p.tx != nil
+	f(r)
+	p.ring.Store(r)
 }
 
-func (p *cipherManager) GetRX(k string) (ICipher, bool) {
-	p.mtx.RLock()
-	defer p.mtx.RUnlock()
+func (r *keyring) activateTX(id uint8) bool {
+	for _, e := range r.txStaged {
+		if e.id == id {
+			r.tx, r.hasTX = e, true
+			return true
+		}
+	}
+	return false
+}
 
-	cipher, ok := p.rxs[k]
-	return cipher, ok
+// stageEpoch returns a new slice with e replacing the key of the same id
+// or appended as the newest key.
+func stageEpoch(epochs []epoch, e epoch) []epoch {
+	result := make([]epoch, 0, maxEpochs)
+	for _, old := range epochs {
+		if old.id != e.id {
+			result = append(result, old)
+		}
+	}
+	if len(result) == maxEpochs {
+		result = result[1:]
+	}
+	return append(result, e)
 }
@@ -0,0 +1,87 @@
+package crypto
+
+import (
+	"fmt"
+	"testing"
+)
+
+const benchSenders = 64
+
+func newBenchCipherManager() ICipherManager {
+	key := make([]byte, 32)
+	manager := NewCipherManager()
+	manager.SetTX(NewCipher(key))
+	for i := 0; i < benchSenders; i++ {
+		manager.AddRX(fmt.Sprintf("sender-%d", i), NewCipher(key))
+	}
+	return manager
+}
+
+func TestCipherManagerRotation(t *testing.T) {
+	key := make([]byte, 32)
+	manager := NewCipherManager()
+	manager.StageRX("a", 1, NewCipher(key))
+	if _, ok := manager.GetRX("a", 1); !ok {
+		t.Fatal("staged rx key not found")
+	}
+	manager.StageTX(1, NewCipher(key))
+	if _, _, ok := manager.GetTX(); ok {
+		t.Fatal("tx key used before activation")
+	}
+	if !manager.ActivateTX(1) {
+		t.Fatal("activate staged tx key")
+	}
+	if id, _, ok := manager.GetTX(); !ok || id != 1 {
+		t.Fatalf("tx key %d", id)
+	}
+}
+
+func BenchmarkCipherManagerGetTX(b *testing.B) {
+	manager := newBenchCipherManager()
+	if _, _, ok := manager.GetTX(); !ok {
+		b.Fatal("no tx key")
+	}
+	b.ReportAllocs()
+	b.RunParallel(func(pb *testing.PB) {
+		for pb.Next() {
+			if _, _, ok := manager.GetTX(); !ok {
+				// Fatal must not be called from the parallel goroutines
+				b.Error("no tx key")
+				return
+			}
+		}
+	})
+}
+
+func BenchmarkCipherManagerGetRX(b *testing.B) {
+	manager := newBenchCipherManager()
+	idents := make([]string, benchSenders)
+	for i := range idents {
+		idents[i] = fmt.Sprintf("sender-%d", i)
+	}
+	for _, ident := range idents {
+		if _, ok := manager.GetRX(ident, 0); !ok {
+			b.Fatalf("no rx key of %s", ident)
+		}
+	}
+	b.ReportAllocs()
+	b.RunParallel(func(pb *testing.PB) {
+		for i := 0; pb.Next(); i++ {
+			if _, ok := manager.GetRX(idents[i%len(idents)], 0); !ok {
+				b.Error("no rx key")
+				return
+			}
+		}
+	})
+}
+
+// BenchmarkCipherManagerAddRX measures the copy of the keyring done by every
+// key change of a room with benchSenders senders.
+func BenchmarkCipherManagerAddRX(b *testing.B) {
+	manager := newBenchCipherManager()
+	cipher := NewCipher(make([]byte, 32))
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		manager.AddRX("sender-0", cipher)
+	}
+}
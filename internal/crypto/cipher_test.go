@@ -0,0 +1,141 @@
+package crypto
+
+import (
+	"crypto/aes"
+	"crypto/cipher"
+	"crypto/rand"
+	"fmt"
+	"io"
+	"testing"
+)
+
+var benchSizes = []int{64, 1024, 4 * 1024, 16 * 1024}
+
+// perCallCipher seals and opens as sCipher did before it cached the GCM
+// state: a new AEAD and a random nonce for every call.
+type perCallCipher struct {
+	block cipher.Block
+}
+
+func newPerCallCipher(key []byte) *perCallCipher {
+	block, err := aes.NewCipher(key)
+	if err != nil {
+		panic(err)
+	}
+	return &perCallCipher{block: block}
+}
+
+func (p *perCallCipher) Encrypt(plaintext []byte) ([]byte, error) {
+	gcm, err := cipher.NewGCM(p.block)
+	if err != nil {
+		return nil, err
+	}
+	nonce := make([]byte, gcm.NonceSize())
+	if _, err := io.ReadFull(rand.Reader, nonce); err != nil {
+		return nil, err
+	}
+	return gcm.Seal(nonce, nonce, plaintext, nil), nil
+}
+
+func (p *perCallCipher) DecryptTo(dst, ciphertext []byte) ([]byte, error) {
+	gcm, err := cipher.NewGCM(p.block)
+	if err != nil {
+		return nil, err
+	}
+	nonceSize := gcm.NonceSize()
+	return gcm.Open(dst[:0], ciphertext[:nonceSize], ciphertext[nonceSize:], nil)
+}
+
+func TestCipherRoundTrip(t *testing.T) {
+	key := make([]byte, 32)
+	tx, rx := NewCipher(key), NewCipher(key)
+	for _, size := range append([]int{0}, benchSizes...) {
+		plaintext := make([]byte, size)
+		ciphertext, err := tx.Encrypt(plaintext)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if len(ciphertext) != size+tx.Overhead() {
+			t.Fatalf("ciphertext size %d", len(ciphertext))
+		}
+		if _, err := rx.Decrypt(ciphertext); err != nil {
+			t.Fatal(err)
+		}
+	}
+}
+
+func TestCipherNoncePrefix(t *testing.T) {
+	key := make([]byte, 32)
+	a, err := NewCipher(key).Encrypt(nil)
+	if err != nil {
+		t.Fatal(err)
+	}
+	b, err := NewCipher(key).Encrypt(nil)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if string(a[:nonceSize]) == string(b[:nonceSize]) {
+		t.Fatal("ciphers of one key share a nonce")
+	}
+}
+
+func BenchmarkSeal(b *testing.B) {
+	key := make([]byte, 32)
+	for _, size := range benchSizes {
+		plaintext := make([]byte, size)
+
+		b.Run(fmt.Sprintf("cached/%d", size), func(b *testing.B) {
+			c := NewCipher(key)
+			buff := make([]byte, 0, size+c.Overhead())
+			b.SetBytes(int64(size))
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				if _, err := c.EncryptTo(buff, plaintext); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+		b.Run(fmt.Sprintf("per-call/%d", size), func(b *testing.B) {
+			c := newPerCallCipher(key)
+			b.SetBytes(int64(size))
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				if _, err := c.Encrypt(plaintext); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+func BenchmarkOpen(b *testing.B) {
+	key := make([]byte, 32)
+	for _, size := range benchSizes {
+		ciphertext, err := NewCipher(key).Encrypt(make([]byte, size))
+		if err != nil {
+			b.Fatal(err)
+		}
+		buff := make([]byte, 0, size)
+
+		b.Run(fmt.Sprintf("cached/%d", size), func(b *testing.B) {
+			c := NewCipher(key)
+			b.SetBytes(int64(size))
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				if _, err := c.DecryptTo(buff, ciphertext); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+		b.Run(fmt.Sprintf("per-call/%d", size), func(b *testing.B) {
+			c := newPerCallCipher(key)
+			b.SetBytes(int64(size))
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				if _, err := c.DecryptTo(buff, ciphertext); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
@@ -2,13 +2,21 @@ package crypto
 
 type ICipherManager interface {
 	SetTX(ICipher)
+	StageTX(uint8, ICipher)
+	ActivateTX(uint8) bool
 	DelRX(string)
 	AddRX(string, ICipher)
-	GetTX() (ICipher, bool)
-	GetRX(string) (ICipher, bool)
+	StageRX(string, uint8, ICipher)
+	GetTX() (uint8, ICipher, bool)
+	GetRX(string, uint8) (ICipher, bool)
 }
 
 type ICipher interface {
+	Fingerprint() Fingerprint
+	NonceSize() int
+	Overhead() int
 	Encrypt([]byte) ([]byte, error)
+	EncryptTo([]byte, []byte) ([]byte, error)
 	Decrypt([]byte) ([]byte, error)
+	DecryptTo([]byte, []byte) ([]byte, error)
 }
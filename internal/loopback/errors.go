@@ -0,0 +1,8 @@
+package loopback
+
+import "errors"
+
+var (
+	ErrIdentTaken = errors.New("ident taken")
+	ErrClosed     = errors.New("endpoint closed")
+)
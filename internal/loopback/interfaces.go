@@ -0,0 +1,9 @@
+package loopback
+
+type IEndpoint interface {
+	// Send delivers a copy of the payload to the destination endpoints, or
+	// to all other endpoints of the network when there are none. Reliable
+	// payloads are never lost and keep their order.
+	Send(payload []byte, reliable bool, destinations []string) error
+	Close()
+}
@@ -0,0 +1,293 @@
+package loopback
+
+import (
+	"container/heap"
+	"math/rand"
+	"sync"
+	"time"
+)
+
+const (
+	// a sender whose link is busy for longer drops lossy payloads, like
+	// the queue of a congested router
+	maxQueueDelay = time.Second
+)
+
+var (
+	_ IEndpoint = &endpoint{}
+)
+
+var (
+	networksMtx = &sync.Mutex{}
+	networks    = make(map[string]*network)
+)
+
+// Impairment describes the link of one endpoint. It applies to all
+// payloads the endpoint sends.
+type Impairment struct {
+	Latency time.Duration
+	// Jitter adds a uniform random delay up to its value.
+	Jitter time.Duration
+	// Loss and Reorder are probabilities of lossy payloads. A reordered
+	// payload is held back for one more latency and jitter.
+	Loss    float64
+	Reorder float64
+	// Bandwidth caps the bytes per second, 0 is unlimited.
+	Bandwidth int
+	// Seed makes the random decisions reproducible, 0 seeds by time.
+	Seed uint64
+}
+
+// ReceiveFunc gets the payloads of the other endpoints. The payload is
+// shared by all receivers, it must not be modified but may be kept.
+type ReceiveFunc func(payload []byte, sender string)
+
+type network struct {
+	name      string
+	endpoints map[string]*endpoint
+}
+
+// Join connects an endpoint to the in-process network of the name,
+// creating the network for its first endpoint. The disconnected function
+// is called when the endpoint is dropped by Disconnect.
+func Join(name, ident string, impairment Impairment, receive ReceiveFunc, disconnected func()) (IEndpoint, error) {
+	networksMtx.Lock()
+	defer networksMtx.Unlock()
+
+	net, ok := networks[name]
+	if !ok {
+		net = &network{name: name, endpoints: make(map[string]*endpoint)}
+		networks[name] = net
+	}
+	if _, ok := net.endpoints[ident]; ok {
+		return nil, ErrIdentTaken
+	}
+
+	seed := int64(impairment.Seed)
+	if seed == 0 {
+		seed = time.Now().UnixNano()
+	}
+	ep := &endpoint{
+		mtx:          &sync.Mutex{},
+		net:          net,
+		ident:        ident,
+		impairment:   impairment,
+		rand:         rand.New(rand.NewSource(seed)),
+		receive:      receive,
+		disconnected: disconnected,
+		wake:         make(chan struct{}, 1),
+		done:         make(chan struct{}),
+		lastReliable: make(map[string]time.Time),
+	}
+	net.endpoints[ident] = ep
+
+	go ep.run()
+	return ep, nil
+}
+
+type delivery struct {
+	at      time.Time
+	seq     uint64
+	sender  string
+	payload []byte
+}
+
+type deliveryHeap []delivery
+
+func (h deliveryHeap) Len() int { return len(h) }
+func (h deliveryHeap) Less(i, j int) bool {
+	if h[i].at.Equal(h[j].at) {
+		return h[i].seq < h[j].seq
+	}
+	return h[i].at.Before(h[j].at)
+}
+func (h deliveryHeap) Swap(i, j int) { h[i], h[j] = h[j], h[i] }
+func (h *deliveryHeap) Push(x any)   { *h = append(*h, x.(delivery)) }
+func (h *deliveryHeap) Pop() any {
+	old := *h
+	x := old[len(old)-1]
+	old[len(old)-1] = delivery{}
+	*h = old[:len(old)-1]
+	return x
+}
+
+type endpoint struct {
+	mtx        *sync.Mutex
+	net        *network
+	ident      string
+	impairment Impairment
+	rand       *rand.Rand
+	receive    ReceiveFunc
+	closed     bool
+
+	disconnected func()
+
+	// the uplink is busy until then
+	linkFree time.Time
+
+	// payloads to receive, ordered by time
+	pending      deliveryHeap
+	seq          uint64
+	lastReliable map[string]time.Time
+	wake         chan struct{}
+	done         chan struct{}
+}
+
+func (p *endpoint) Send(payload []byte, reliable bool, destinations []string) error {
+	p.mtx.Lock()
+	if p.closed {
+		p.mtx.Unlock()
+		return ErrClosed
+	}
+	now := time.Now()
+	imp := &p.impairment
+
+	sent := now
+	if imp.Bandwidth > 0 {
+		if p.linkFree.After(now) {
+			sent = p.linkFree
+		}
+		if !reliable && sent.Sub(now) > maxQueueDelay {
+			p.mtx.Unlock()
+			return nil
+		}
+		sent = sent.Add(time.Duration(len(payload)) * time.Second / time.Duration(imp.Bandwidth))
+		p.linkFree = sent
+	}
+
+	if !reliable && imp.Loss > 0 && p.rand.Float64() < imp.Loss {
+		p.mtx.Unlock()
+		return nil
+	}
+	at := sent.Add(imp.Latency + p.jitter())
+	if !reliable && imp.Reorder > 0 && p.rand.Float64() < imp.Reorder {
+		at = at.Add(imp.Latency + p.jitter())
+	}
+	p.mtx.Unlock()
+
+	networksMtx.Lock()
+	defer networksMtx.Unlock()
+
+	data := append([]byte(nil), payload...)
+	if len(destinations) != 0 {
+		for _, ident := range destinations {
+			if ep, ok := p.net.endpoints[ident]; ok && ident != p.ident {
+				ep.push(at, p.ident, data, reliable)
+			}
+		}
+		return nil
+	}
+	for ident, ep := range p.net.endpoints {
+		if ident != p.ident {
+			ep.push(at, p.ident, data, reliable)
+		}
+	}
+	return nil
+}
+
+func (p *endpoint) jitter() time.Duration {
+	if p.impairment.Jitter <= 0 {
+		return 0
+	}
+	return time.Duration(p.rand.Int63n(int64(p.impairment.Jitter)))
+}
+
+func (p *endpoint) push(at time.Time, sender string, payload []byte, reliable bool) {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	if p.closed {
+		return
+	}
+	if reliable {
+		// a reliable channel delivers in order whatever the jitter
+		if last := p.lastReliable[sender]; at.Before(last) {
+			at = last
+		}
+		p.lastReliable[sender] = at
+	}
+	p.seq++
+	heap.Push(&p.pending, delivery{at: at, seq: p.seq, sender: sender, payload: payload})
+
+	select {
+	case p.wake <- struct{}{}:
+	default:
+	}
+}
+
+// run calls receive for due payloads one after the other, like the
+// callbacks of a real connection.
+func (p *endpoint) run() {
+	timer := time.NewTimer(time.Hour)
+	defer timer.Stop()
+
+	for {
+		p.mtx.Lock()
+		if p.closed {
+			p.mtx.Unlock()
+			return
+		}
+		wait := time.Hour
+		if len(p.pending) > 0 {
+			next := p.pending[0]
+			if wait = time.Until(next.at); wait <= 0 {
+				heap.Pop(&p.pending)
+				p.mtx.Unlock()
+				p.receive(next.payload, next.sender)
+				continue
+			}
+		}
+		p.mtx.Unlock()
+
+		timer.Reset(wait)
+		select {
+		case <-timer.C:
+		case <-p.wake:
+		case <-p.done:
+			return
+		}
+	}
+}
+
+// Disconnect drops the endpoint of the ident from the network of the name,
+// as a failed link would. It returns false when there is no such endpoint.
+func Disconnect(name, ident string) bool {
+	networksMtx.Lock()
+	var ep *endpoint
+	if net, ok := networks[name]; ok {
+		ep = net.endpoints[ident]
+	}
+	networksMtx.Unlock()
+
+	if ep == nil {
+		return false
+	}
+	ep.Close()
+	if ep.disconnected != nil {
+		ep.disconnected()
+	}
+	return true
+}
+
+// Close leaves the network. A receive call which is running may still
+// complete after Close returns.
+func (p *endpoint) Close() {
+	networksMtx.Lock()
+	if p.net.endpoints[p.ident] == p {
+		delete(p.net.endpoints, p.ident)
+		if len(p.net.endpoints) == 0 {
+			delete(networks, p.net.name)
+		}
+	}
+	networksMtx.Unlock()
+
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	if p.closed {
+		return
+	}
+	p.closed = true
+	p.pending = nil
+	close(p.done)
+}
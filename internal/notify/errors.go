@@ -0,0 +1,7 @@
+package notify
+
+import "errors"
+
+var (
+	ErrNotSupported = errors.New("not supported")
+)
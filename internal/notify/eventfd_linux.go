@@ -0,0 +1,80 @@
+package notify
+
+import (
+	"encoding/binary"
+	"sync"
+	"sync/atomic"
+
+	"golang.org/x/sys/unix"
+)
+
+var (
+	_ INotifier = &eventFD{}
+)
+
+// eventFD is a level-triggered readiness flag: the descriptor is readable
+// exactly while the flag is set.
+type eventFD struct {
+	mtx    *sync.Mutex
+	fd     int
+	set    atomic.Bool
+	closed bool
+}
+
+func NewNotifier() (INotifier, error) {
+	fd, err := unix.Eventfd(0, unix.EFD_NONBLOCK|unix.EFD_CLOEXEC)
+	if err != nil {
+		return nil, err
+	}
+	return &eventFD{mtx: &sync.Mutex{}, fd: fd}, nil
+}
+
+func (p *eventFD) FD() int {
+	return p.fd
+}
+
+func (p *eventFD) Set() {
+	if p.set.Load() {
+		return
+	}
+
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	if p.closed || p.set.Load() {
+		return
+	}
+	var buf [8]byte
+	binary.NativeEndian.PutUint64(buf[:], 1)
+	_, _ = unix.Write(p.fd, buf[:])
+	p.set.Store(true)
+}
+
+func (p *eventFD) Clear() {
+	if !p.set.Load() {
+		return
+	}
+
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	if p.closed || !p.set.Load() {
+		return
+	}
+	var buf [8]byte
+	_, _ = unix.Read(p.fd, buf[:])
+	p.set.Store(false)
+}
+
+// Close closes the descriptor. Later calls of Set and Clear do nothing,
+// so they never touch a descriptor number reused by the process.
+func (p *eventFD) Close() {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	if p.closed {
+		return
+	}
+	p.closed = true
+	_ = unix.Close(p.fd)
+}
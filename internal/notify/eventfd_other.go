@@ -0,0 +1,7 @@
+//go:build !linux
+
+package notify
+
+func NewNotifier() (INotifier, error) {
+	return nil, ErrNotSupported
+}
@@ -0,0 +1,8 @@
+package notify
+
+type INotifier interface {
+	FD() int
+	Set()
+	Clear()
+	Close()
+}
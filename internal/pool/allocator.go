@@ -0,0 +1,19 @@
+package pool
+
+var (
+	_ IAllocator = heapAllocator{}
+)
+
+type heapAllocator struct{}
+
+// NewHeapAllocator returns an allocator backed by the Go heap. Buffers from
+// it must not be handed over to C code.
+func NewHeapAllocator() IAllocator {
+	return heapAllocator{}
+}
+
+func (heapAllocator) Alloc(n int) []byte {
+	return make([]byte, n)
+}
+
+func (heapAllocator) Free([]byte) {}
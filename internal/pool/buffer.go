@@ -0,0 +1,150 @@
+package pool
+
+import (
+	"sync"
+	"sync/atomic"
+)
+
+const (
+	// a handle of a lent buffer is the generation of its slot above the
+	// index of the slot
+	lendSlotBits  = 20
+	maxLendSlots  = 1 << lendSlotBits
+	lendChunkBits = 10
+	lendChunkSize = 1 << lendChunkBits
+
+	// generations wrap within the bits left by the index, after 2^11 lends
+	// of one slot on 32-bit platforms
+	lendGenMask = ^uintptr(0) >> lendSlotBits
+)
+
+// lendSlot refers to one buffer for its whole life, so lending it again
+// only bumps the generation.
+type lendSlot struct {
+	// odd while the buffer is lent to C
+	gen atomic.Uintptr
+	buf atomic.Pointer[Buffer]
+}
+
+var (
+	// the slots are allocated in chunks which never move, so handles are
+	// resolved without a lock
+	lendMtx    sync.Mutex
+	lendChunks [maxLendSlots / lendChunkSize]atomic.Pointer[[lendChunkSize]lendSlot]
+	lendSlots  int
+	freeSlots  []int
+)
+
+type Buffer struct {
+	pool  *bufferPool
+	class int
+	data  []byte
+	size  int
+	refs  atomic.Int32
+	// index of the lend slot plus one, zero until the buffer is lent
+	slot int
+}
+
+// Bytes returns the used part of the buffer.
+func (p *Buffer) Bytes() []byte {
+	return p.data[:p.size]
+}
+
+// Cap returns the whole underlying memory of the buffer.
+func (p *Buffer) Cap() []byte {
+	return p.data[:cap(p.data)]
+}
+
+func (p *Buffer) SetSize(n int) {
+	p.size = n
+}
+
+// Lend hands one owner of the buffer over to C code and returns a new
+// handle for it, which is resolved back once with TakeLent. It fails when
+// all lend slots are taken by live buffers.
+func (p *Buffer) Lend() (uintptr, bool) {
+	if p.slot == 0 && !p.takeSlot() {
+		return 0, false
+	}
+	index := p.slot - 1
+	slot := lendSlotAt(index)
+	gen := (slot.gen.Load() + 1) & lendGenMask
+	slot.gen.Store(gen)
+	return gen<<lendSlotBits | uintptr(index), true
+}
+
+// Retain adds one more owner of the buffer, which must call Release too.
+func (p *Buffer) Retain() {
+	p.refs.Add(1)
+}
+
+// Release drops one owner of the buffer. The last one gives the buffer back
+// to its pool.
+func (p *Buffer) Release() {
+	if p.refs.Add(-1) != 0 {
+		return
+	}
+	p.pool.put(p)
+}
+
+// TakeLent resolves a handle of Lend and forgets it. It returns false for
+// handles which are unknown or were taken already, so a stale or repeated
+// release from C can't touch a buffer lent again since.
+func TakeLent(h uintptr) (*Buffer, bool) {
+	index, gen := int(h&(maxLendSlots-1)), h>>lendSlotBits
+	if gen&1 == 0 {
+		return nil, false
+	}
+	chunk := lendChunks[index>>lendChunkBits].Load()
+	if chunk == nil {
+		return nil, false
+	}
+	slot := &chunk[index&(lendChunkSize-1)]
+	if !slot.gen.CompareAndSwap(gen, (gen+1)&lendGenMask) {
+		return nil, false
+	}
+	return slot.buf.Load(), true
+}
+
+func lendSlotAt(index int) *lendSlot {
+	return &lendChunks[index>>lendChunkBits].Load()[index&(lendChunkSize-1)]
+}
+
+// takeSlot gives the buffer a lend slot, once in its life.
+func (p *Buffer) takeSlot() bool {
+	lendMtx.Lock()
+	defer lendMtx.Unlock()
+
+	var index int
+	switch {
+	case len(freeSlots) != 0:
+		index = freeSlots[len(freeSlots)-1]
+		freeSlots = freeSlots[:len(freeSlots)-1]
+	case lendSlots < maxLendSlots:
+		index = lendSlots
+		lendSlots++
+		if chunk := &lendChunks[index>>lendChunkBits]; chunk.Load() == nil {
+			chunk.Store(new([lendChunkSize]lendSlot))
+		}
+	default:
+		return false
+	}
+	lendSlotAt(index).buf.Store(p)
+	p.slot = index + 1
+	return true
+}
+
+// free gives the slot back with its generation, so that stale handles of
+// the buffer don't resolve to the next one in the slot.
+func (p *Buffer) free(allocator IAllocator) {
+	allocator.Free(p.data)
+	p.data = nil
+
+	if p.slot != 0 {
+		lendMtx.Lock()
+		lendSlotAt(p.slot - 1).buf.Store(nil)
+		freeSlots = append(freeSlots, p.slot-1)
+		lendMtx.Unlock()
+		p.slot = 0
+	}
+}
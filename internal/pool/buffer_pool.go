@@ -0,0 +1,181 @@
+package pool
+
+import (
+	"sync"
+	"time"
+)
+
+const (
+	minClassSize = 256
+
+	// free memory which stayed unused for the whole interval is given
+	// back to the allocator
+	trimInterval = 5 * time.Second
+)
+
+var (
+	_ IPool = &bufferPool{}
+)
+
+type bufferPool struct {
+	mtx       *sync.Mutex
+	allocator IAllocator
+	closed    bool
+	maxBytes  int
+	allBytes  int
+	freeBytes int
+	lowFree   int
+	trimArmed bool
+	trimTimer *time.Timer
+	classes   [][]*Buffer
+}
+
+// NewBufferPool creates a pool of power-of-two sized buffers. The total
+// memory owned by the pool (free and in use) never exceeds maxBytes, and
+// free buffers left idle for trimInterval are freed.
+func NewBufferPool(allocator IAllocator, maxBytes int) IPool {
+	return &bufferPool{
+		mtx:       &sync.Mutex{},
+		allocator: allocator,
+		maxBytes:  maxBytes,
+		classes:   make([][]*Buffer, 0, 16),
+	}
+}
+
+func (p *bufferPool) Get(n int) (*Buffer, bool) {
+	class, classSize := sizeClass(n)
+
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	if p.closed {
+		return nil, false
+	}
+
+	for len(p.classes) <= class {
+		p.classes = append(p.classes, nil)
+	}
+
+	var buf *Buffer
+	if free := p.classes[class]; len(free) != 0 {
+		buf = free[len(free)-1]
+		p.classes[class] = free[:len(free)-1]
+		p.takeFree(classSize)
+	} else {
+		if p.allBytes+classSize > p.maxBytes && !p.shrink(classSize) {
+			return nil, false
+		}
+		data := p.allocator.Alloc(classSize)
+		if data == nil {
+			return nil, false
+		}
+		p.allBytes += classSize
+		buf = &Buffer{pool: p, class: class, data: data}
+	}
+
+	buf.size = n
+	buf.refs.Store(1)
+	return buf, true
+}
+
+func (p *bufferPool) Close() {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	p.closed = true
+	if p.trimTimer != nil {
+		p.trimTimer.Stop()
+	}
+	for i, free := range p.classes {
+		for _, buf := range free {
+			buf.free(p.allocator)
+		}
+		p.classes[i] = nil
+	}
+}
+
+func (p *bufferPool) put(buf *Buffer) {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	if p.closed {
+		buf.free(p.allocator)
+		return
+	}
+	p.classes[buf.class] = append(p.classes[buf.class], buf)
+	p.freeBytes += cap(buf.data)
+	p.armTrim()
+}
+
+func (p *bufferPool) takeFree(n int) {
+	p.freeBytes -= n
+	p.lowFree = min(p.lowFree, p.freeBytes)
+}
+
+func (p *bufferPool) armTrim() {
+	if p.trimArmed {
+		return
+	}
+	p.trimArmed = true
+	p.lowFree = p.freeBytes
+	if p.trimTimer == nil {
+		p.trimTimer = time.AfterFunc(trimInterval, p.trim)
+		return
+	}
+	p.trimTimer.Reset(trimInterval)
+}
+
+// trim frees the largest idle buffers up to the least amount of free
+// memory seen since the previous trim, so a steady working set is kept.
+func (p *bufferPool) trim() {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	if p.closed {
+		return
+	}
+	p.trimArmed = false
+
+	excess := p.lowFree
+	for i := len(p.classes) - 1; i >= 0 && excess > 0; i-- {
+		free := p.classes[i]
+		for len(free) != 0 && cap(free[len(free)-1].data) <= excess {
+			buf := free[len(free)-1]
+			free = free[:len(free)-1]
+			excess -= cap(buf.data)
+			p.allBytes -= cap(buf.data)
+			p.freeBytes -= cap(buf.data)
+			buf.free(p.allocator)
+		}
+		p.classes[i] = free
+	}
+
+	if p.freeBytes != 0 {
+		p.armTrim()
+	}
+}
+
+// shrink frees idle buffers of other size classes until need bytes fit
+// into the budget.
+func (p *bufferPool) shrink(need int) bool {
+	for i, free := range p.classes {
+		for len(free) != 0 && p.allBytes+need > p.maxBytes {
+			buf := free[len(free)-1]
+			free = free[:len(free)-1]
+			p.allBytes -= cap(buf.data)
+			p.takeFree(cap(buf.data))
+			buf.free(p.allocator)
+		}
+		p.classes[i] = free
+	}
+	return p.allBytes+need <= p.maxBytes
+}
+
+func sizeClass(n int) (int, int) {
+	class, classSize := 0, minClassSize
+	for classSize < n {
+		class++
+		classSize <<= 1
+	}
+	return class, classSize
+}
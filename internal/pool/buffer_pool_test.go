@@ -0,0 +1,127 @@
+package pool
+
+import (
+	"testing"
+)
+
+type countingAllocator struct {
+	allocs, frees int
+}
+
+func (p *countingAllocator) Alloc(n int) []byte {
+	p.allocs++
+	return make([]byte, n)
+}
+
+func (p *countingAllocator) Free([]byte) {
+	p.frees++
+}
+
+func TestBufferPoolTrim(t *testing.T) {
+	allocator := &countingAllocator{}
+	p := NewBufferPool(allocator, 1<<20).(*bufferPool)
+	defer p.Close()
+
+	a, _ := p.Get(1000)
+	b, _ := p.Get(1000)
+	a.Release()
+	b.Release()
+
+	// one buffer is reused between the trims, the other stays idle
+	c, _ := p.Get(1000)
+	c.Release()
+	p.trim()
+	if allocator.frees != 1 || p.allBytes != 1024 {
+		t.Fatalf("frees %d, bytes %d", allocator.frees, p.allBytes)
+	}
+
+	p.trim()
+	if allocator.frees != 2 || p.allBytes != 0 || p.trimArmed {
+		t.Fatalf("frees %d, bytes %d", allocator.frees, p.allBytes)
+	}
+}
+
+func TestBufferLend(t *testing.T) {
+	p := NewBufferPool(&countingAllocator{}, 1<<20)
+	defer p.Close()
+
+	a, _ := p.Get(1000)
+	h, _ := a.Lend()
+	if buf, ok := TakeLent(h); !ok || buf != a {
+		t.Fatal("lent buffer")
+	}
+	a.Release()
+
+	// the buffer is lent again under a new handle, a stale release of the
+	// old one must not take it
+	b, _ := p.Get(1000)
+	if b != a {
+		t.Fatal("buffer not reused")
+	}
+	h2, _ := b.Lend()
+	if _, ok := TakeLent(h); ok || h2 == h {
+		t.Fatal("stale handle")
+	}
+	if _, ok := TakeLent(0); ok {
+		t.Fatal("zero handle")
+	}
+	if _, ok := TakeLent(h2); !ok {
+		t.Fatal("lent buffer")
+	}
+	b.Release()
+
+	// a freed buffer gives its slot to the next one, which gets a new
+	// generation
+	p.(*bufferPool).trim()
+	p.(*bufferPool).trim()
+	c, _ := p.Get(1000)
+	if c == b {
+		t.Fatal("buffer not freed")
+	}
+	h3, _ := c.Lend()
+	if _, ok := TakeLent(h2); ok || h3 == h2 {
+		t.Fatal("stale handle of a freed buffer")
+	}
+	if buf, ok := TakeLent(h3); !ok || buf != c {
+		t.Fatal("lent buffer")
+	}
+	c.Release()
+}
+
+// BenchmarkBufferLend lends a pooled buffer to C and takes it back, as a
+// borrowed read and its release do.
+func BenchmarkBufferLend(b *testing.B) {
+	p := NewBufferPool(NewHeapAllocator(), 1<<20)
+	defer p.Close()
+
+	b.ReportAllocs()
+	b.RunParallel(func(pb *testing.PB) {
+		for pb.Next() {
+			buf, ok := p.Get(1200)
+			if !ok {
+				b.Error("get")
+				return
+			}
+			h, _ := buf.Lend()
+			if buf, ok = TakeLent(h); !ok {
+				b.Error("take lent")
+				return
+			}
+			buf.Release()
+		}
+	})
+}
+
+func BenchmarkBufferPoolGet(b *testing.B) {
+	p := NewBufferPool(NewHeapAllocator(), 1<<20)
+	defer p.Close()
+
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		buf, ok := p.Get(1200)
+		if !ok {
+			b.Fatal("get")
+		}
+		buf.Release()
+	}
+}
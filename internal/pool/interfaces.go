@@ -0,0 +1,11 @@
+package pool
+
+type IPool interface {
+	Get(int) (*Buffer, bool)
+	Close()
+}
+
+type IAllocator interface {
+	Alloc(int) []byte
+	Free([]byte)
+}
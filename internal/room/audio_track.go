@@ -0,0 +1,486 @@
+package room
+
+import (
+	"context"
+	"math"
+	"slices"
+	"time"
+
+	lksdk "github.com/livekit/server-sdk-go/v2"
+	"github.com/number571/clivekit/internal/audio"
+	"github.com/pion/webrtc/v4"
+	"github.com/pion/webrtc/v4/pkg/media"
+)
+
+const (
+	audioTrackName = "clivekit-audio"
+	// the longest Opus packet holds 120ms
+	maxDecodedFrameSize = 6 * audio.FrameSize
+)
+
+// AudioFormat describes interleaved PCM exchanged with the caller.
+type AudioFormat struct {
+	SampleRate   int
+	Channels     int
+	SampleFormat audio.SampleFormat
+}
+
+// valid does not limit channels to the Opus ones, as raw data takes more.
+func (p AudioFormat) valid() bool {
+	return p.SampleRate > 0 && p.Channels >= 1 && p.Channels <= math.MaxUint8 && p.SampleFormat.Valid()
+}
+
+// FrameSize returns the number of bytes of one interleaved frame.
+func (p AudioFormat) FrameSize() int {
+	return p.Channels * p.SampleFormat.Size()
+}
+
+// audioPublisher cuts written PCM into Opus frames at the codec rate and
+// writes them sealed to the local track.
+type audioPublisher struct {
+	format    AudioFormat
+	track     *lksdk.LocalTrack
+	trackSID  string
+	options   *lksdk.TrackPublicationOptions
+	encoder   audio.IEncoder
+	resampler audio.IResampler
+	pcm       []float32
+	input     []float32
+	packet    []byte
+	sealBuff  []byte
+}
+
+func (p *audioPublisher) close() {
+	p.encoder.Close()
+	if p.resampler != nil {
+		p.resampler.Close()
+	}
+}
+
+// PublishAudioTrack publishes an Opus track of the room. The track carries
+// samples sealed with the tx key, so only subscribers holding the key can
+// decode it. A bitrate of 0 leaves the choice to the encoder.
+func (p *secureRoom) PublishAudioTrack(format AudioFormat, bitrate int) error {
+	if !format.valid() {
+		return audio.ErrFormat
+	}
+
+	p.audioMtx.Lock()
+	defer p.audioMtx.Unlock()
+
+	if p.audioPublisher != nil {
+		return ErrTrackPublished
+	}
+
+	transport := p.getTransport()
+	if transport == nil {
+		return ErrNotConnected
+	}
+
+	encoder, err := audio.NewEncoder(format.Channels, bitrate)
+	if err != nil {
+		return err
+	}
+	pub := &audioPublisher{format: format, encoder: encoder}
+
+	if format.SampleRate != audio.SampleRate {
+		pub.resampler, err = audio.NewResampler(format.SampleRate, audio.SampleRate, format.Channels)
+		if err != nil {
+			pub.close()
+			return err
+		}
+	}
+
+	pub.track, err = lksdk.NewLocalTrack(webrtc.RTPCodecCapability{
+		MimeType:  webrtc.MimeTypeOpus,
+		ClockRate: audio.SampleRate,
+		Channels:  2,
+	})
+	if err != nil {
+		pub.close()
+		return err
+	}
+
+	pub.options = &lksdk.TrackPublicationOptions{
+		Name:   audioTrackName,
+		Stereo: format.Channels == 2,
+	}
+	pub.trackSID, err = transport.PublishTrack(pub.track, pub.options)
+	if err != nil {
+		pub.close()
+		return err
+	}
+
+	p.audioPublisher = pub
+	return nil
+}
+
+// WriteAudioFrames takes interleaved samples in the format of the published
+// track and sends every complete 20ms frame. The rest is kept until the
+// next call.
+func (p *secureRoom) WriteAudioFrames(pcm []byte) error {
+	p.audioMtx.Lock()
+	defer p.audioMtx.Unlock()
+
+	pub := p.audioPublisher
+	if pub == nil {
+		return ErrNoTrack
+	}
+	if len(pcm)%pub.format.FrameSize() != 0 {
+		return audio.ErrFormat
+	}
+
+	// samples are converted to float32 where the encoder reads them
+	var (
+		err     error
+		samples = len(pcm) / pub.format.SampleFormat.Size()
+	)
+	if pub.resampler != nil {
+		pub.input = slices.Grow(pub.input[:0], samples)[:samples]
+		audio.Convert(audio.Bytes(pub.input), audio.F32, pcm, pub.format.SampleFormat)
+		pub.pcm, err = pub.resampler.Resample(pub.pcm, pub.input)
+		if err != nil {
+			return err
+		}
+	} else {
+		n := len(pub.pcm)
+		pub.pcm = slices.Grow(pub.pcm, samples)[:n+samples]
+		audio.Convert(audio.Bytes(pub.pcm[n:]), audio.F32, pcm, pub.format.SampleFormat)
+	}
+
+	var (
+		frameLen = audio.FrameSize * pub.format.Channels
+		offset   = 0
+	)
+	defer func() {
+		pub.pcm = pub.pcm[:copy(pub.pcm, pub.pcm[offset:])]
+	}()
+
+	for ; len(pub.pcm)-offset >= frameLen; offset += frameLen {
+		pub.packet, err = pub.encoder.Encode(pub.packet, pub.pcm[offset:offset+frameLen])
+		if err != nil {
+			return err
+		}
+
+		keyID, cipher, ok := p.cipherManager.GetTX()
+		if !ok {
+			return ErrGetTXCipher
+		}
+
+		start := time.Now()
+		pub.sealBuff, err = sealSample(pub.sealBuff, keyID, cipher, pub.packet)
+		if err != nil {
+			return err
+		}
+		p.stats.encryptLatency.observe(start)
+
+		// the track packetizes the sample before returning
+		err = pub.track.WriteSample(media.Sample{Data: pub.sealBuff, Duration: audio.FrameDuration}, nil)
+		if err != nil {
+			return err
+		}
+	}
+
+	return nil
+}
+
+// GetAudioTrackFormat returns the format of the published audio track.
+func (p *secureRoom) GetAudioTrackFormat() (AudioFormat, bool) {
+	p.audioMtx.Lock()
+	defer p.audioMtx.Unlock()
+
+	if p.audioPublisher == nil {
+		return AudioFormat{}, false
+	}
+	return p.audioPublisher.format, true
+}
+
+func (p *secureRoom) UnpublishAudioTrack() error {
+	p.audioMtx.Lock()
+	defer p.audioMtx.Unlock()
+
+	pub := p.audioPublisher
+	if pub == nil {
+		return ErrNoTrack
+	}
+	p.audioPublisher = nil
+	defer pub.close()
+
+	// a room without transport has no published tracks
+	transport := p.getTransport()
+	if transport == nil {
+		return nil
+	}
+	return transport.UnpublishTrack(pub.trackSID)
+}
+
+type audioSubscription struct {
+	format  AudioFormat
+	playout bool
+}
+
+// SubscribeAudio makes the room decode remote audio tracks to the format.
+// Without playout, the PCM of every frame is queued as an audio packet of
+// the track owner. With playout, frames go to a jitter buffer per sender
+// instead, which the caller drains with PullAudio. The zero format stops
+// decoding.
+func (p *secureRoom) SubscribeAudio(format AudioFormat, playout bool) error {
+	if format == (AudioFormat{}) {
+		p.audioSubscription.Store(nil)
+		return nil
+	}
+	if !format.valid() {
+		return audio.ErrFormat
+	}
+	p.audioSubscription.Store(&audioSubscription{format: format, playout: playout})
+	return nil
+}
+
+// PullAudio fills out with the next interleaved samples of the sender in
+// the subscribed format and returns the number of frames which were not
+// silence. It returns false if there is no playout buffer of the sender.
+func (p *secureRoom) PullAudio(ident string, out []byte) (int, bool) {
+	p.playoutMtx.RLock()
+	playout, ok := p.playouts[ident]
+	p.playoutMtx.RUnlock()
+
+	if !ok || len(out)%playout.format.FrameSize() != 0 {
+		clear(out)
+		return 0, false
+	}
+	return playout.pull(out), true
+}
+
+func (p *secureRoom) GetAudioSubscription() (AudioFormat, bool) {
+	sub := p.audioSubscription.Load()
+	if sub == nil {
+		return AudioFormat{}, false
+	}
+	return sub.format, true
+}
+
+// readAudioTrack runs until the track ends with the room connection.
+func (p *secureRoom) readAudioTrack(track *webrtc.TrackRemote, ident string) {
+	defer p.trackReaders.Done()
+
+	var (
+		format    AudioFormat
+		decoder   audio.IDecoder
+		resampler audio.IResampler
+		playout   *jitterBuffer
+		pcm       = make([]float32, maxDecodedFrameSize*audio.MaxChannels)
+		resampled []float32
+	)
+	closeCodec := func() {
+		if decoder != nil {
+			decoder.Close()
+			decoder = nil
+		}
+		if resampler != nil {
+			resampler.Close()
+			resampler = nil
+		}
+	}
+	defer closeCodec()
+	defer func() { p.setPlayout(ident, playout, nil) }()
+
+	for {
+		packet, _, err := track.ReadRTP()
+		if err != nil {
+			return
+		}
+
+		sub := p.audioSubscription.Load()
+		if sub == nil {
+			continue
+		}
+		if !p.accepts(AudioDataType, ident) {
+			continue
+		}
+
+		if sub.playout {
+			if playout == nil || playout.format != sub.format {
+				next, err := newJitterBuffer(sub.format, p.stats)
+				if err != nil {
+					continue
+				}
+				p.setPlayout(ident, playout, next)
+				playout = next
+			}
+			buffer, frame, ok := p.openPacket(ident, packet.Payload)
+			if !ok {
+				continue
+			}
+			playout.push(packet.SequenceNumber, packet.Timestamp, buffer, frame)
+			continue
+		}
+
+		if sub.format != format {
+			closeCodec()
+			if decoder, resampler, err = newAudioDecoder(sub.format); err != nil {
+				format = AudioFormat{}
+				continue
+			}
+			format = sub.format
+		}
+
+		buffer, frame, ok := p.openPacket(ident, packet.Payload)
+		if !ok {
+			continue
+		}
+		n, err := decoder.Decode(pcm[:maxDecodedFrameSize*format.Channels], frame)
+		buffer.Release()
+		if err != nil {
+			p.stats.drop(BadFrameDropReason)
+			continue
+		}
+
+		samples := pcm[:n*format.Channels]
+		if resampler != nil {
+			resampled, err = resampler.Resample(resampled[:0], samples)
+			if err != nil {
+				continue
+			}
+			samples = resampled
+		}
+		p.deliverSamples(ident, samples, format.SampleFormat)
+	}
+}
+
+// setPlayout replaces the playout buffer of the sender, if it is still
+// old, and closes old.
+func (p *secureRoom) setPlayout(ident string, old, next *jitterBuffer) {
+	p.playoutMtx.Lock()
+	if cur, ok := p.playouts[ident]; !ok || cur == old {
+		if next != nil {
+			p.playouts[ident] = next
+		} else {
+			delete(p.playouts, ident)
+		}
+	}
+	p.playoutMtx.Unlock()
+
+	if old != nil {
+		old.close()
+	}
+}
+
+func newAudioDecoder(format AudioFormat) (audio.IDecoder, audio.IResampler, error) {
+	decoder, err := audio.NewDecoder(format.Channels)
+	if err != nil {
+		return nil, nil, err
+	}
+	if format.SampleRate == audio.SampleRate {
+		return decoder, nil, nil
+	}
+	resampler, err := audio.NewResampler(audio.SampleRate, format.SampleRate, format.Channels)
+	if err != nil {
+		decoder.Close()
+		return nil, nil, err
+	}
+	return decoder, resampler, nil
+}
+
+// deliverSamples queues decoded PCM in the sample format of the
+// subscription as an audio packet of the sender.
+func (p *secureRoom) deliverSamples(ident string, samples []float32, format audio.SampleFormat) {
+	if len(samples) == 0 {
+		return
+	}
+
+	buffer, ok := p.buffPool.Get(len(samples) * format.Size())
+	if !ok {
+		p.stats.drop(NoBufferDropReason)
+		return
+	}
+	audio.Convert(buffer.Bytes(), format, audio.Bytes(samples), audio.F32)
+
+	p.deliver(newPooledDataPacket(AudioDataType, ident, buffer.Bytes(), buffer))
+}
+
+// EnqueueAudioData sends interleaved PCM as audio messages tagged with the
+// format, split at frame borders. Receivers subscribed to audio get it in
+// their own sample format.
+func (p *secureRoom) EnqueueAudioData(ctx context.Context, format AudioFormat, pcm []byte) error {
+	if !format.valid() || len(pcm)%format.FrameSize() != 0 {
+		return audio.ErrFormat
+	}
+
+	var (
+		header    = audio.Header{SampleFormat: format.SampleFormat, Channels: format.Channels, SampleRate: format.SampleRate}
+		frameSize = format.FrameSize()
+		chunkSize = (p.buffSize - audio.HeaderSize) / frameSize * frameSize
+	)
+	if chunkSize <= 0 {
+		return ErrBuffSize
+	}
+
+	for len(pcm) > 0 {
+		n := min(len(pcm), chunkSize)
+
+		buffer, ok := p.sendPool.Get(audio.HeaderSize + n)
+		if !ok {
+			p.sendQueue.addDropped(1)
+			return ErrQueueFull
+		}
+		payload := append(audio.AppendHeader(buffer.Bytes()[:0], header), pcm[:n]...)
+
+		dp := newPooledDataPacket(AudioDataType, "", payload, buffer)
+		dp.flags = rawAudioFlag
+		if err := p.sendQueue.push(ctx, dp); err != nil {
+			return err
+		}
+		pcm = pcm[n:]
+	}
+
+	return nil
+}
+
+// adaptAudioPacket converts an audio message tagged by rawAudioFlag to the
+// sample format of the subscription and strips the tag. Untagged messages
+// and all messages without a subscription pass unchanged. It returns false
+// if the message was dropped.
+func (p *secureRoom) adaptAudioPacket(pack *DataPacket, flags uint8) (*DataPacket, bool) {
+	sub := p.audioSubscription.Load()
+	if sub == nil || pack.Type != AudioDataType || flags&rawAudioFlag == 0 {
+		return pack, true
+	}
+	header, ok := audio.ParseHeader(pack.Payload)
+	if !ok {
+		p.stats.drop(BadFrameDropReason)
+		pack.Release()
+		return nil, false
+	}
+
+	// only the sample format is converted, the stream stays unresampled
+	if header.Channels != sub.format.Channels || header.SampleRate != sub.format.SampleRate {
+		p.stats.drop(BadFrameDropReason)
+		pack.Release()
+		return nil, false
+	}
+
+	var (
+		pcm     = pack.Payload[audio.HeaderSize:]
+		samples = len(pcm) / header.SampleFormat.Size()
+		dstSize = samples * sub.format.SampleFormat.Size()
+	)
+	if sub.format.SampleFormat.Size() <= header.SampleFormat.Size() {
+		// in place, the kernels read each sample before the output that
+		// does not grow reaches it
+		audio.Convert(pack.Payload, sub.format.SampleFormat, pcm, header.SampleFormat)
+		pack.Payload = pack.Payload[:dstSize]
+		return pack, true
+	}
+
+	buffer, ok := p.buffPool.Get(dstSize)
+	if !ok {
+		p.stats.drop(NoBufferDropReason)
+		pack.Release()
+		return nil, false
+	}
+	audio.Convert(buffer.Bytes(), sub.format.SampleFormat, pcm, header.SampleFormat)
+
+	adapted := newPooledDataPacket(AudioDataType, pack.Ident, buffer.Bytes(), buffer)
+	pack.Release()
+	return adapted, true
+}
@@ -0,0 +1,41 @@
+package room
+
+import (
+	"bytes"
+	"testing"
+
+	"github.com/number571/clivekit/internal/audio"
+)
+
+func TestAdaptAudioPacket(t *testing.T) {
+	room := newSecureRoom(&ConnectInfo{BuffSize: 1 << 16})
+	defer room.Close()
+
+	format := AudioFormat{SampleRate: 48000, Channels: 1, SampleFormat: audio.F32}
+	if err := room.SubscribeAudio(format, false); err != nil {
+		t.Fatal(err)
+	}
+
+	// an untagged message passes as is, even if it looks like a tag
+	header := audio.Header{SampleFormat: audio.S16, Channels: 1, SampleRate: 48000}
+	payload := audio.AppendHeader(nil, header)
+	payload = append(payload, 0, 0x40, 0, 0xc0)
+	pack, ok := room.adaptAudioPacket(&DataPacket{Type: AudioDataType, Payload: bytes.Clone(payload)}, 0)
+	if !ok || !bytes.Equal(pack.Payload, payload) {
+		t.Fatal("untagged message changed")
+	}
+
+	pack, ok = room.adaptAudioPacket(&DataPacket{Type: AudioDataType, Payload: bytes.Clone(payload)}, rawAudioFlag)
+	if !ok {
+		t.Fatal("tagged message dropped")
+	}
+	want := audio.Bytes([]float32{0.5, -0.5})
+	if !bytes.Equal(pack.Payload, want) {
+		t.Fatalf("got %v, want %v", pack.Payload, want)
+	}
+
+	// a tagged message with a broken tag is dropped
+	if _, ok := room.adaptAudioPacket(&DataPacket{Type: AudioDataType, Payload: []byte{1, 2}}, rawAudioFlag); ok {
+		t.Fatal("broken tag accepted")
+	}
+}
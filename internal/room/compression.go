@@ -0,0 +1,140 @@
+package room
+
+import (
+	"sync"
+	"sync/atomic"
+
+	"github.com/number571/clivekit/internal/compress"
+)
+
+const (
+	// payloads below this size are not worth the compression header
+	defaultCompressMinSize = 256
+)
+
+type compressPolicy [endDataType]compress.ICompressor
+
+// compression holds the compressors which a room applies to the payloads
+// of each data type before sealing, and the decompressors of received
+// messages. All peers of a room must share the zstd dictionary.
+type compression struct {
+	mtx     *sync.Mutex
+	dict    []byte
+	minSize int
+	maxSize int
+	policy  atomic.Pointer[compressPolicy]
+
+	codecsMtx *sync.RWMutex
+	codecs    map[compress.Codec]compress.ICompressor
+}
+
+func newCompression(dict []byte, minSize, maxSize int) *compression {
+	if minSize <= 0 {
+		minSize = defaultCompressMinSize
+	}
+	c := &compression{
+		mtx:       &sync.Mutex{},
+		dict:      dict,
+		minSize:   minSize,
+		maxSize:   maxSize,
+		codecsMtx: &sync.RWMutex{},
+		codecs:    make(map[compress.Codec]compress.ICompressor, 2),
+	}
+	c.policy.Store(&compressPolicy{})
+	return c
+}
+
+func (p *compression) set(dataType DataType, codec compress.Codec) error {
+	compressor, err := p.get(codec)
+	if err != nil {
+		return err
+	}
+
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	policy := *p.policy.Load()
+	policy[dataType] = compressor
+	p.policy.Store(&policy)
+	return nil
+}
+
+// forPayload returns the compressor of a payload, or nil when it is sent
+// as is.
+func (p *compression) forPayload(dataType DataType, size int) compress.ICompressor {
+	if size < p.minSize {
+		return nil
+	}
+	return p.policy.Load()[dataType]
+}
+
+func (p *compression) get(codec compress.Codec) (compress.ICompressor, error) {
+	p.codecsMtx.RLock()
+	compressor, ok := p.codecs[codec]
+	p.codecsMtx.RUnlock()
+	if ok {
+		return compressor, nil
+	}
+
+	compressor, err := compress.Get(codec, p.dict, p.maxSize)
+	if err != nil {
+		return nil, err
+	}
+
+	p.codecsMtx.Lock()
+	p.codecs[codec] = compressor
+	p.codecsMtx.Unlock()
+	return compressor, nil
+}
+
+// SetCompression selects the codec applied to payloads of the data type
+// from the minimum size of the room on. Messages which do not get smaller
+// are sent as is.
+func (p *secureRoom) SetCompression(dataType DataType, codec compress.Codec) error {
+	return p.compression.set(dataType, codec)
+}
+
+// decompressPacket replaces the payload of a compressed message by the
+// decompressed one.
+func (p *secureRoom) decompressPacket(pack *DataPacket, flags uint8) (*DataPacket, bool) {
+	codec := compress.Codec(flags & codecFlagMask)
+	if codec == compress.NoCodec {
+		return pack, true
+	}
+
+	compressor, err := p.compression.get(codec)
+	if err != nil {
+		p.stats.drop(BadFrameDropReason)
+		pack.Release()
+		return nil, false
+	}
+	size, err := compressor.DecompressedSize(pack.Payload)
+	if err != nil {
+		p.stats.drop(BadFrameDropReason)
+		pack.Release()
+		return nil, false
+	}
+	if size > p.buffSize {
+		p.stats.drop(OversizeDropReason)
+		pack.Release()
+		return nil, false
+	}
+
+	buffer, ok := p.buffPool.Get(size)
+	if !ok {
+		p.stats.drop(NoBufferDropReason)
+		pack.Release()
+		return nil, false
+	}
+	out, err := compressor.Decompress(buffer.Bytes(), pack.Payload)
+	if err != nil || len(out) != size || (size != 0 && &out[0] != &buffer.Bytes()[0]) {
+		p.stats.drop(BadFrameDropReason)
+		buffer.Release()
+		pack.Release()
+		return nil, false
+	}
+
+	unpacked := newPooledDataPacket(pack.Type, pack.Ident, out, buffer)
+	pack.Release()
+	return unpacked, true
+}
@@ -0,0 +1,285 @@
+package room
+
+import (
+	"sync"
+	"time"
+)
+
+const (
+	reconnectMinDelay = 250 * time.Millisecond
+	reconnectMaxDelay = 10 * time.Second
+
+	// rooms connected at once by ConnectToSecureRooms, to spare the
+	// signalling server
+	bulkConnectLimit = 32
+)
+
+// ConnectState tells whether a room can send and receive.
+type ConnectState int
+
+const (
+	// ConnectingState is the state of a room until its first connection
+	// is established.
+	ConnectingState ConnectState = iota
+	ConnectedState
+	// ReconnectingState is the state of a room which lost its connection.
+	// It keeps its keys, queues and tracks and connects again until it is
+	// closed.
+	ReconnectingState
+	// FailedState is the state of a room whose first connection failed.
+	FailedState
+	closedState
+)
+
+// ConnectToSecureRoom connects the room and returns once it is connected.
+func ConnectToSecureRoom(connInfo *ConnectInfo) (ISecureRoom, error) {
+	room := newSecureRoom(connInfo)
+	if err := room.connect(); err != nil {
+		room.Close()
+		return nil, err
+	}
+	return room, nil
+}
+
+// ConnectToSecureRoomAsync returns the room at once and connects it in the
+// background. The state of the room tells when the connection is up;
+// meanwhile published messages fail and queued ones wait.
+func ConnectToSecureRoomAsync(connInfo *ConnectInfo) ISecureRoom {
+	room := newSecureRoom(connInfo)
+	room.connector.Add(1)
+	go func() {
+		defer room.connector.Done()
+		_ = room.connect()
+	}()
+	return room
+}
+
+// ConnectToSecureRooms connects the rooms in parallel. The rooms and errors
+// are by connect info; the room of a failed connection is nil.
+func ConnectToSecureRooms(connInfos []*ConnectInfo) ([]ISecureRoom, []error) {
+	var (
+		rooms = make([]ISecureRoom, len(connInfos))
+		errs  = make([]error, len(connInfos))
+		limit = make(chan struct{}, bulkConnectLimit)
+		wg    = &sync.WaitGroup{}
+	)
+	for i, connInfo := range connInfos {
+		wg.Add(1)
+		limit <- struct{}{}
+		go func(i int, connInfo *ConnectInfo) {
+			defer func() { <-limit; wg.Done() }()
+			rooms[i], errs[i] = ConnectToSecureRoom(connInfo)
+		}(i, connInfo)
+	}
+	wg.Wait()
+	return rooms, errs
+}
+
+// CloseRooms closes the rooms in parallel.
+func CloseRooms(rooms []IRoom) {
+	wg := &sync.WaitGroup{}
+	for _, room := range rooms {
+		wg.Add(1)
+		go func(room IRoom) {
+			defer wg.Done()
+			room.Close()
+		}(room)
+	}
+	wg.Wait()
+}
+
+// GetConnectState returns the state of the room. It also acknowledges the
+// change of state which made the readiness descriptor readable.
+func (p *secureRoom) GetConnectState() ConnectState {
+	p.stateMtx.Lock()
+	state := p.state
+	p.stateMtx.Unlock()
+
+	if state == closedState {
+		state = FailedState
+	}
+	p.stateChanged.Store(false)
+	p.updateReadiness()
+	return state
+}
+
+// getTransport returns the transport of the room, or nil while it is not
+// connected.
+func (p *secureRoom) getTransport() ITransport {
+	if t := p.transport.Load(); t != nil {
+		return *t
+	}
+	return nil
+}
+
+// connect makes the first connection of the room.
+func (p *secureRoom) connect() error {
+	p.stateMtx.Lock()
+	gen := p.transportGen
+	p.stateMtx.Unlock()
+
+	transport, err := connectTransport(p, p.connInfo, gen)
+	if err != nil {
+		p.setState(gen, ConnectingState, FailedState)
+		return err
+	}
+	if !p.setTransport(gen, transport, ConnectingState) {
+		transport.Disconnect()
+		return ErrClosedChannel
+	}
+	return nil
+}
+
+// onTransportLost starts to reconnect a room whose transport of the
+// generation was disconnected by the other side, also after the transport
+// failed to resume by itself.
+func (p *secureRoom) onTransportLost(gen uint64) {
+	p.stateMtx.Lock()
+	lost := p.state == ConnectedState || (p.state == ReconnectingState && !p.reconnecting)
+	if p.transportGen != gen || !lost {
+		p.stateMtx.Unlock()
+		return
+	}
+	p.state = ReconnectingState
+	p.reconnecting = true
+	p.connector.Add(1)
+	p.stateMtx.Unlock()
+	p.signalState()
+
+	go p.reconnect(gen)
+}
+
+// onTransportResuming and onTransportResumed follow the transport while it
+// restores its own connection.
+func (p *secureRoom) onTransportResuming(gen uint64) {
+	p.setState(gen, ConnectedState, ReconnectingState)
+}
+
+func (p *secureRoom) onTransportResumed(gen uint64) {
+	p.setState(gen, ReconnectingState, ConnectedState)
+}
+
+func (p *secureRoom) reconnect(gen uint64) {
+	defer p.connector.Done()
+
+	if old := p.transport.Swap(nil); old != nil {
+		(*old).Disconnect()
+	}
+
+	delay := reconnectMinDelay
+	for gen++; ; gen++ {
+		p.stateMtx.Lock()
+		if p.state != ReconnectingState {
+			p.reconnecting = false
+			p.stateMtx.Unlock()
+			return
+		}
+		p.transportGen = gen
+		p.stateMtx.Unlock()
+
+		transport, err := connectTransport(p, p.connInfo, gen)
+		if err == nil {
+			p.republishTracks(transport)
+			if !p.setTransport(gen, transport, ReconnectingState) {
+				transport.Disconnect()
+			}
+			return
+		}
+
+		select {
+		case <-p.closing:
+			return
+		case <-time.After(delay):
+		}
+		delay = min(2*delay, reconnectMaxDelay)
+	}
+}
+
+// setTransport makes the transport of the generation current, unless the
+// room was closed meanwhile.
+func (p *secureRoom) setTransport(gen uint64, transport ITransport, from ConnectState) bool {
+	p.stateMtx.Lock()
+	if p.state != from || p.transportGen != gen {
+		p.stateMtx.Unlock()
+		return false
+	}
+	p.transport.Store(&transport)
+	p.state = ConnectedState
+	p.reconnecting = false
+	p.stateCond.Broadcast()
+	p.stateMtx.Unlock()
+
+	p.signalState()
+	return true
+}
+
+// setState changes the state of the transport of the generation.
+func (p *secureRoom) setState(gen uint64, from, to ConnectState) {
+	p.stateMtx.Lock()
+	if p.state != from || p.transportGen != gen {
+		p.stateMtx.Unlock()
+		return
+	}
+	p.state = to
+	p.stateCond.Broadcast()
+	p.stateMtx.Unlock()
+
+	p.signalState()
+}
+
+// signalState makes the readiness descriptor readable until the state is
+// read or data is read.
+func (p *secureRoom) signalState() {
+	p.stateChanged.Store(true)
+	if n := p.notifier.Load(); n != nil {
+		(*n).Set()
+	}
+}
+
+// waitConnected blocks while the room is connecting. It returns false once
+// the room is closing or failed.
+func (p *secureRoom) waitConnected() bool {
+	p.stateMtx.Lock()
+	defer p.stateMtx.Unlock()
+
+	for p.state == ConnectingState || p.state == ReconnectingState {
+		p.stateCond.Wait()
+	}
+	return p.state == ConnectedState
+}
+
+// beginClose stops reconnecting and wakes up the send worker.
+func (p *secureRoom) beginClose() {
+	p.stateMtx.Lock()
+	p.state = closedState
+	p.stateCond.Broadcast()
+	p.stateMtx.Unlock()
+
+	close(p.closing)
+}
+
+// republishTracks publishes the local tracks of the room again over a new
+// transport. A track which can't be published is dropped, so that writes
+// to it fail with ErrNoTrack.
+func (p *secureRoom) republishTracks(transport ITransport) {
+	p.audioMtx.Lock()
+	if pub := p.audioPublisher; pub != nil {
+		if sid, err := transport.PublishTrack(pub.track, pub.options); err == nil {
+			pub.trackSID = sid
+		} else {
+			p.audioPublisher = nil
+			pub.close()
+		}
+	}
+	p.audioMtx.Unlock()
+
+	p.videoMtx.Lock()
+	if pub := p.videoPublisher; pub != nil {
+		if sid, err := transport.PublishTrack(pub.track, pub.options); err == nil {
+			pub.trackSID = sid
+		} else {
+			p.videoPublisher = nil
+		}
+	}
+	p.videoMtx.Unlock()
+}
@@ -0,0 +1,70 @@
+package room
+
+import (
+	"testing"
+	"time"
+
+	lksdk "github.com/livekit/server-sdk-go/v2"
+)
+
+func TestReconnectAfterLinkDrop(t *testing.T) {
+	room, err := ConnectToSecureRoom(&ConnectInfo{
+		Host:        LoopbackScheme + "reconnect",
+		BuffSize:    1 << 16,
+		ConnectInfo: lksdk.ConnectInfo{RoomName: "room", ParticipantIdentity: "a"},
+	})
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer room.Close()
+
+	if err := room.DropLoopbackLink(); err != nil {
+		t.Fatal(err)
+	}
+	if state := room.GetConnectState(); state != ReconnectingState {
+		t.Fatal(state)
+	}
+
+	deadline := time.Now().Add(5 * time.Second)
+	for room.GetConnectState() != ConnectedState {
+		if time.Now().After(deadline) {
+			t.Fatal("not reconnected")
+		}
+		time.Sleep(10 * time.Millisecond)
+	}
+}
+
+func TestReconnectAfterFailedResume(t *testing.T) {
+	room, err := ConnectToSecureRoom(&ConnectInfo{
+		Host:        LoopbackScheme + "resume",
+		BuffSize:    1 << 16,
+		ConnectInfo: lksdk.ConnectInfo{RoomName: "room", ParticipantIdentity: "a"},
+	})
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer room.Close()
+
+	// the transport fails to resume its own connection
+	p := room.(*secureRoom)
+	p.stateMtx.Lock()
+	gen := p.transportGen
+	p.stateMtx.Unlock()
+	p.onTransportResuming(gen)
+	if state := room.GetConnectState(); state != ReconnectingState {
+		t.Fatal(state)
+	}
+	p.onTransportLost(gen)
+
+	waitConnected(t, room)
+}
+
+func waitConnected(t *testing.T, room IRoom) {
+	deadline := time.Now().Add(5 * time.Second)
+	for room.GetConnectState() != ConnectedState {
+		if time.Now().After(deadline) {
+			t.Fatal("not reconnected")
+		}
+		time.Sleep(10 * time.Millisecond)
+	}
+}
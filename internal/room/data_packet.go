@@ -1,9 +1,26 @@
 package room
 
+import (
+	"sync"
+
+	"github.com/number571/clivekit/internal/pool"
+)
+
+var (
+	dataPacketPool = sync.Pool{New: func() any { return &DataPacket{} }}
+)
+
 type DataPacket struct {
 	Type    DataType
 	Ident   string
 	Payload []byte
+	// Destinations limits a published packet to the participants with
+	// these identities. It is broadcast to the whole room when empty.
+	Destinations []string
+
+	// frame flags of the message other than its codec
+	flags  uint8
+	buffer *pool.Buffer
 }
 
 type DataType int
@@ -17,3 +34,76 @@ const (
 
 	endDataType
 )
+
+func newPooledDataPacket(dataType DataType, ident string, payload []byte, buffer *pool.Buffer) *DataPacket {
+	dp := dataPacketPool.Get().(*DataPacket)
+	dp.Type = dataType
+	dp.Ident = ident
+	dp.Payload = payload
+	dp.buffer = buffer
+	return dp
+}
+
+// newChunkDataPacket returns a packet viewing a part of the payload of dp,
+// sharing its buffer.
+func newChunkDataPacket(dp *DataPacket, start, end int) *DataPacket {
+	if dp.buffer != nil {
+		dp.buffer.Retain()
+	}
+	return newPooledDataPacket(dp.Type, dp.Ident, dp.Payload[start:end], dp.buffer)
+}
+
+// Detach takes ownership of the pooled payload buffer away from the packet
+// and releases the packet itself. The caller must release the buffer.
+func (p *DataPacket) Detach() (*pool.Buffer, bool) {
+	buffer := p.buffer
+	if buffer == nil {
+		return nil, false
+	}
+	p.buffer = nil
+	p.Release()
+	return buffer, true
+}
+
+// Release returns a received packet and its payload buffer to the pools.
+// The packet must not be used after that.
+func (p *DataPacket) Release() {
+	if p.buffer != nil {
+		p.buffer.Release()
+		p.buffer = nil
+	}
+	*p = DataPacket{}
+	dataPacketPool.Put(p)
+}
+
+func vectorSize(vector [][]byte) int {
+	size := 0
+	for _, b := range vector {
+		size += len(b)
+	}
+	return size
+}
+
+// copyVector copies the bytes of the vector from offset on into dst.
+func copyVector(dst []byte, vector [][]byte, offset int) int {
+	n := 0
+	for _, b := range vector {
+		if offset >= len(b) {
+			offset -= len(b)
+			continue
+		}
+		n += copy(dst[n:], b[offset:])
+		offset = 0
+		if n == len(dst) {
+			break
+		}
+	}
+	return n
+}
+
+func appendVector(dst []byte, vector [][]byte) []byte {
+	for _, b := range vector {
+		dst = append(dst, b...)
+	}
+	return dst
+}
@@ -0,0 +1,156 @@
+package room
+
+import (
+	"hash/maphash"
+	"runtime"
+	"sync"
+	"sync/atomic"
+)
+
+const (
+	decryptQueueSize = 256
+)
+
+var (
+	decryptWorkersMtx = &sync.RWMutex{}
+	decryptWorkers    = newDecryptWorkerPool(runtime.GOMAXPROCS(0))
+	// the number of workers was set instead of following GOMAXPROCS
+	decryptWorkersSet bool
+
+	lastShardSalt atomic.Uint64
+)
+
+type decryptJob struct {
+	room    *secureRoom
+	ident   string
+	payload []byte
+}
+
+// decryptWorkerPool opens the received frames of all rooms on several
+// cores. The frames of one sender to one room always go to the same worker,
+// so they are delivered in order.
+type decryptWorkerPool struct {
+	seed   maphash.Seed
+	shards []chan decryptJob
+}
+
+// newDecryptWorkerPool returns nil for less than two workers, frames are
+// then opened by the goroutine of the transport.
+func newDecryptWorkerPool(n int) *decryptWorkerPool {
+	if n < 2 {
+		return nil
+	}
+	pool := &decryptWorkerPool{
+		seed:   maphash.MakeSeed(),
+		shards: make([]chan decryptJob, n),
+	}
+	for i := range pool.shards {
+		pool.shards[i] = make(chan decryptJob, decryptQueueSize)
+		go pool.run(pool.shards[i])
+	}
+	return pool
+}
+
+func (p *decryptWorkerPool) run(jobs <-chan decryptJob) {
+	for job := range jobs {
+		select {
+		case <-job.room.closed:
+			job.room.stats.drop(ClosedDropReason)
+		default:
+			job.room.openData(job.payload, job.ident)
+		}
+		job.room.opening.Done()
+	}
+}
+
+// submit never blocks the transport: when the shard is full the frame is
+// dropped, so that a flooded room does not stall the rooms sharing the
+// shard or the transport loop. The frame must be counted by beginOpen.
+func (p *decryptWorkerPool) submit(room *secureRoom, ident string, payload []byte) {
+	shard := (maphash.String(p.seed, ident) ^ room.shardSalt) % uint64(len(p.shards))
+	select {
+	case p.shards[shard] <- decryptJob{room: room, ident: ident, payload: payload}:
+	default:
+		room.stats.drop(DecryptBacklogDropReason)
+		room.opening.Done()
+	}
+}
+
+// close lets the workers finish the queued frames and exit.
+func (p *decryptWorkerPool) close() {
+	for _, shard := range p.shards {
+		close(shard)
+	}
+}
+
+// SetDecryptWorkers sets the number of goroutines which open received data
+// frames of all rooms of the process, GOMAXPROCS by default. With less than
+// two, frames are opened by the goroutine of the transport. Frames which
+// arrive while the workers are replaced may be delivered out of order.
+func SetDecryptWorkers(n int) {
+	pool := newDecryptWorkerPool(n)
+
+	decryptWorkersMtx.Lock()
+	old := decryptWorkers
+	decryptWorkers = pool
+	decryptWorkersSet = true
+	decryptWorkersMtx.Unlock()
+
+	if old != nil {
+		old.close()
+	}
+}
+
+// FollowMaxProcs resizes the decrypt workers to a new GOMAXPROCS, unless
+// their number was set by SetDecryptWorkers.
+func FollowMaxProcs(n int) {
+	decryptWorkersMtx.Lock()
+	if decryptWorkersSet || (decryptWorkers == nil && n < 2) ||
+		(decryptWorkers != nil && len(decryptWorkers.shards) == n) {
+		decryptWorkersMtx.Unlock()
+		return
+	}
+	old := decryptWorkers
+	decryptWorkers = newDecryptWorkerPool(n)
+	decryptWorkersMtx.Unlock()
+
+	if old != nil {
+		old.close()
+	}
+}
+
+// onData takes a sealed frame of the sender from any transport and opens it
+// on a decrypt worker. Transports must not reuse the payload.
+func (p *secureRoom) onData(payload []byte, ident string) {
+	if !p.beginOpen() {
+		p.stats.drop(ClosedDropReason)
+		return
+	}
+
+	decryptWorkersMtx.RLock()
+	if pool := decryptWorkers; pool != nil {
+		pool.submit(p, ident, payload)
+		decryptWorkersMtx.RUnlock()
+		return
+	}
+	decryptWorkersMtx.RUnlock()
+
+	p.openData(payload, ident)
+	p.opening.Done()
+}
+
+// beginOpen counts a frame to be opened, unless the room is closed. Close
+// waits for the counted frames before it frees the reassembler and the
+// buffer pool.
+func (p *secureRoom) beginOpen() bool {
+	p.mtx.RLock()
+	defer p.mtx.RUnlock()
+
+	select {
+	case <-p.closed:
+		return false
+	default:
+		p.opening.Add(1)
+		return true
+	}
+}
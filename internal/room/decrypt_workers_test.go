@@ -0,0 +1,24 @@
+package room
+
+import (
+	"hash/maphash"
+	"testing"
+)
+
+func TestDecryptBacklogDrop(t *testing.T) {
+	room := newSecureRoom(&ConnectInfo{BuffSize: 1 << 16})
+	defer room.Close()
+
+	// a shard without a worker is always full
+	pool := &decryptWorkerPool{seed: maphash.MakeSeed(), shards: []chan decryptJob{make(chan decryptJob)}}
+	if !room.beginOpen() {
+		t.Fatal("room closed")
+	}
+	pool.submit(room, "peer", []byte{1})
+
+	var stats Stats
+	room.stats.load(&stats)
+	if stats.Drops[DecryptBacklogDropReason] != 1 || stats.Drops[QueueFullDropReason] != 0 {
+		t.Fatalf("drops %v", stats.Drops)
+	}
+}
@@ -0,0 +1,103 @@
+package room
+
+import (
+	"runtime"
+	"sync"
+	"sync/atomic"
+)
+
+const (
+	deliveryChSize = 256
+)
+
+// DataHandler receives packets pushed by the room. The packet is valid only
+// until the handler returns.
+type DataHandler func(*DataPacket)
+
+// deliverer runs handlers on one goroutine locked to its OS thread, so
+// every handler of a room is always called from the same thread and never
+// concurrently.
+type deliverer struct {
+	mtx      *sync.Mutex
+	started  bool
+	stopping atomic.Bool
+	handlers [endDataType]atomic.Pointer[DataHandler]
+	packCh   chan *DataPacket
+	done     chan struct{}
+}
+
+func newDeliverer() *deliverer {
+	return &deliverer{
+		mtx:    &sync.Mutex{},
+		packCh: make(chan *DataPacket, deliveryChSize),
+		done:   make(chan struct{}),
+	}
+}
+
+func (p *deliverer) setHandler(dataType DataType, handler DataHandler) {
+	if handler == nil {
+		p.handlers[dataType].Store(nil)
+		return
+	}
+
+	p.mtx.Lock()
+	if !p.started {
+		p.started = true
+		go p.run()
+	}
+	p.mtx.Unlock()
+
+	p.handlers[dataType].Store(&handler)
+}
+
+func (p *deliverer) hasHandler(dataType DataType) bool {
+	return p.handlers[dataType].Load() != nil
+}
+
+// push must not be called after close.
+func (p *deliverer) push(pack *DataPacket) bool {
+	select {
+	case p.packCh <- pack:
+		return true
+	default:
+		pack.Release()
+		return false
+	}
+}
+
+// stop ends the delivery without waiting for the running handler, see
+// wait. Packets not delivered yet are dropped.
+func (p *deliverer) stop() {
+	p.stopping.Store(true)
+	close(p.packCh)
+
+	p.mtx.Lock()
+	started := p.started
+	p.started = true
+	p.mtx.Unlock()
+
+	if !started {
+		for pack := range p.packCh {
+			pack.Release()
+		}
+		close(p.done)
+	}
+}
+
+// wait waits for the running handler to return after stop.
+func (p *deliverer) wait() {
+	<-p.done
+}
+
+func (p *deliverer) run() {
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+	defer close(p.done)
+
+	for pack := range p.packCh {
+		if handler := p.handlers[pack.Type].Load(); handler != nil && !p.stopping.Load() {
+			(*handler)(pack)
+		}
+		pack.Release()
+	}
+}
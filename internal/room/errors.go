@@ -3,7 +3,12 @@ package room
 import "errors"
 
 var (
-	ErrBuffSize      = errors.New("buff size")
-	ErrGetTXCipher   = errors.New("get tx cipher")
-	ErrClosedChannel = errors.New("closed channel")
+	ErrBuffSize       = errors.New("buff size")
+	ErrGetTXCipher    = errors.New("get tx cipher")
+	ErrClosedChannel  = errors.New("closed channel")
+	ErrQueueFull      = errors.New("queue full")
+	ErrTrackPublished = errors.New("track published")
+	ErrNoTrack        = errors.New("no track")
+	ErrNotSupported   = errors.New("not supported by transport")
+	ErrNotConnected   = errors.New("not connected")
 )
@@ -0,0 +1,93 @@
+package room
+
+import (
+	"context"
+	"sync"
+
+	"github.com/number571/clivekit/internal/compress"
+	"github.com/number571/clivekit/internal/crypto"
+)
+
+type txKey struct {
+	keyID       uint8
+	fingerprint crypto.Fingerprint
+	compressor  compress.ICompressor
+}
+
+type txGroup struct {
+	cipher  crypto.ICipher
+	rooms   []int
+	sealed  *sealedMessage
+	latency latencyHistogram
+}
+
+// PublishDataPacketToRooms publishes one message to several rooms. It is
+// sealed once for each distinct tx key and compressor of the rooms, and
+// the sealed frames are published to all rooms concurrently. The errors
+// are by room.
+func PublishDataPacketToRooms(ctx context.Context, rooms []ISecureRoom, dataPack *DataPacket) []error {
+	var (
+		errs   = make([]error, len(rooms))
+		groups = make(map[txKey]*txGroup)
+	)
+
+	for i, r := range rooms {
+		room, ok := r.(*secureRoom)
+		if !ok {
+			errs[i] = r.PublishDataPacket(ctx, dataPack)
+			continue
+		}
+		if len(dataPack.Payload) > room.buffSize {
+			errs[i] = ErrBuffSize
+			continue
+		}
+		keyID, cipher, ok := room.cipherManager.GetTX()
+		if !ok {
+			errs[i] = ErrGetTXCipher
+			continue
+		}
+
+		key := txKey{
+			keyID:       keyID,
+			fingerprint: cipher.Fingerprint(),
+			compressor:  room.compression.forPayload(dataPack.Type, len(dataPack.Payload)),
+		}
+		group, ok := groups[key]
+		if !ok {
+			// the cipher of the first room seals for the whole group
+			group = &txGroup{cipher: cipher}
+			groups[key] = group
+		}
+		group.rooms = append(group.rooms, i)
+	}
+
+	wg := &sync.WaitGroup{}
+	for key, group := range groups {
+		group.sealed = sealedPool.Get().(*sealedMessage)
+		err := group.sealed.seal(key.keyID, group.cipher, key.compressor, dataPack, &group.latency)
+		// every room of the group encrypted the message, as if it sealed alone
+		for _, i := range group.rooms {
+			rooms[i].(*secureRoom).stats.encryptLatency.add(&group.latency)
+		}
+		if err != nil {
+			for _, i := range group.rooms {
+				errs[i] = err
+			}
+			continue
+		}
+
+		for _, i := range group.rooms {
+			wg.Add(1)
+			go func(i int, sealed *sealedMessage) {
+				defer wg.Done()
+				errs[i] = rooms[i].(*secureRoom).publishSealed(sealed, dataPack.Destinations)
+			}(i, group.sealed)
+		}
+	}
+	wg.Wait()
+
+	for _, group := range groups {
+		sealedPool.Put(group.sealed)
+	}
+	return errs
+}
@@ -0,0 +1,40 @@
+package room
+
+import (
+	"context"
+	"testing"
+
+	"github.com/number571/clivekit/internal/crypto"
+)
+
+func TestFanoutEncryptLatency(t *testing.T) {
+	rooms := make([]ISecureRoom, 3)
+	for i := range rooms {
+		room, _, _ := newKeyedRoom(t, &ConnectInfo{BuffSize: 1 << 16})
+		defer room.Close()
+		rooms[i] = room
+	}
+	// the last room seals with a key of its own
+	rooms[2].(*secureRoom).cipherManager.SetTX(crypto.NewCipher(append(make([]byte, 31), 1)))
+
+	// the rooms are not connected, but the message is sealed for them
+	payload := make([]byte, 3*fragmentSize)
+	for i, err := range PublishDataPacketToRooms(context.Background(), rooms, &DataPacket{Type: TextDataType, Payload: payload}) {
+		if err != ErrNotConnected {
+			t.Fatalf("room %d: %v", i, err)
+		}
+	}
+
+	// the first two rooms share the seal, each counts all its fragments
+	for i, r := range rooms {
+		var stats Stats
+		r.(*secureRoom).stats.load(&stats)
+		sealed := uint64(0)
+		for _, n := range stats.EncryptLatency {
+			sealed += n
+		}
+		if sealed != 3 {
+			t.Fatalf("room %d: %d fragments encrypted, want 3", i, sealed)
+		}
+	}
+}
@@ -0,0 +1,255 @@
+package room
+
+import (
+	"encoding/binary"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/number571/clivekit/internal/pool"
+)
+
+const (
+	// frame = type (1) || flags (1) || message id (4) ||
+	//         fragment index (2) || fragment count (2) || fragment
+	frameHeaderSize = 10
+
+	// fragmentSize keeps one sealed fragment together with the LiveKit
+	// packet framing below the ~1200 byte SCTP payload of a datagram, so
+	// the data channel never has to fragment it again.
+	fragmentSize = 1024
+
+	reassemblyTimeout  = time.Second
+	reassemblyMaxBytes = 8 << 20
+
+	// codecFlagMask selects the compression codec of the message from the
+	// frame flags
+	codecFlagMask = 0x03
+	// rawAudioFlag marks an audio message as raw PCM behind an audio.Header
+	rawAudioFlag = 0x04
+)
+
+var (
+	// message ids are process wide, so that one sealed message can be
+	// published to several rooms
+	lastMessageID atomic.Uint32
+)
+
+type frameHeader struct {
+	dataType  DataType
+	flags     uint8
+	messageID uint32
+	fragIndex uint16
+	fragCount uint16
+}
+
+func nextMessageID() uint32 {
+	return lastMessageID.Add(1)
+}
+
+func fragmentCount(size int) int {
+	if size == 0 {
+		return 1
+	}
+	return (size + fragmentSize - 1) / fragmentSize
+}
+
+func (p *frameHeader) encode(b []byte) {
+	b[0] = byte(p.dataType)
+	b[1] = p.flags
+	binary.BigEndian.PutUint32(b[2:6], p.messageID)
+	binary.BigEndian.PutUint16(b[6:8], p.fragIndex)
+	binary.BigEndian.PutUint16(b[8:10], p.fragCount)
+}
+
+func decodeFrameHeader(b []byte) (frameHeader, bool) {
+	if len(b) < frameHeaderSize {
+		return frameHeader{}, false
+	}
+	h := frameHeader{
+		dataType:  DataType(b[0]),
+		flags:     b[1],
+		messageID: binary.BigEndian.Uint32(b[2:6]),
+		fragIndex: binary.BigEndian.Uint16(b[6:8]),
+		fragCount: binary.BigEndian.Uint16(b[8:10]),
+	}
+	if h.dataType >= endDataType || h.fragCount == 0 || h.fragIndex >= h.fragCount {
+		return frameHeader{}, false
+	}
+	if len(b)-frameHeaderSize > fragmentSize {
+		return frameHeader{}, false
+	}
+	if h.fragIndex+1 != h.fragCount && len(b)-frameHeaderSize != fragmentSize {
+		return frameHeader{}, false
+	}
+	return h, true
+}
+
+type reassemblyKey struct {
+	ident     string
+	messageID uint32
+}
+
+type reassembly struct {
+	header   frameHeader
+	buffer   *pool.Buffer
+	received []bool
+	left     int
+	size     int
+	deadline time.Time
+}
+
+// reassembler collects fragments of messages until they are complete. The
+// memory of incomplete messages is bounded; the oldest ones are dropped
+// when a new message does not fit or when they time out.
+type reassembler struct {
+	mtx      *sync.Mutex
+	buffPool pool.IPool
+	buffSize int
+	allBytes int
+	messages map[reassemblyKey]*reassembly
+	stats    *roomStats
+	// no message times out before, zero without messages
+	nextExpire time.Time
+}
+
+func newReassembler(buffPool pool.IPool, buffSize int, stats *roomStats) *reassembler {
+	return &reassembler{
+		mtx:      &sync.Mutex{},
+		buffPool: buffPool,
+		buffSize: buffSize,
+		messages: make(map[reassemblyKey]*reassembly, 16),
+		stats:    stats,
+	}
+}
+
+// add stores the fragment and returns the whole message buffer once the
+// last missing fragment has arrived.
+func (p *reassembler) add(ident string, h frameHeader, fragment []byte) (*pool.Buffer, frameHeader, bool) {
+	offset := int(h.fragIndex) * fragmentSize
+	if offset+len(fragment) > p.buffSize {
+		p.stats.drop(OversizeDropReason)
+		return nil, frameHeader{}, false
+	}
+
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	// partial messages time out also while no new message starts
+	now := time.Now()
+	if !p.nextExpire.IsZero() && now.After(p.nextExpire) {
+		p.expire(now)
+	}
+	key := reassemblyKey{ident, h.messageID}
+
+	msg, ok := p.messages[key]
+	if !ok {
+		msg, ok = p.newMessage(key, h, now)
+		if !ok {
+			return nil, frameHeader{}, false
+		}
+	}
+	if msg.header.dataType != h.dataType || msg.header.flags != h.flags || msg.header.fragCount != h.fragCount {
+		p.stats.drop(BadFrameDropReason)
+		return nil, frameHeader{}, false
+	}
+	if msg.received[h.fragIndex] {
+		return nil, frameHeader{}, false
+	}
+
+	copy(msg.buffer.Cap()[offset:], fragment)
+	msg.received[h.fragIndex] = true
+	msg.size += len(fragment)
+	msg.left--
+
+	if msg.left != 0 {
+		return nil, frameHeader{}, false
+	}
+
+	p.remove(key, msg)
+	msg.buffer.SetSize(msg.size)
+	return msg.buffer, msg.header, true
+}
+
+func (p *reassembler) close() {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	for key, msg := range p.messages {
+		p.remove(key, msg)
+		msg.buffer.Release()
+	}
+}
+
+func (p *reassembler) newMessage(key reassemblyKey, h frameHeader, now time.Time) (*reassembly, bool) {
+	size := int(h.fragCount) * fragmentSize
+	if size > p.buffSize {
+		size = p.buffSize
+	}
+
+	for p.allBytes+size > reassemblyMaxBytes && p.dropOldest() {
+	}
+	if p.allBytes+size > reassemblyMaxBytes {
+		p.stats.drop(NoBufferDropReason)
+		return nil, false
+	}
+
+	buffer, ok := p.buffPool.Get(size)
+	if !ok {
+		p.stats.drop(NoBufferDropReason)
+		return nil, false
+	}
+
+	msg := &reassembly{
+		header:   h,
+		buffer:   buffer,
+		received: make([]bool, h.fragCount),
+		left:     int(h.fragCount),
+		deadline: now.Add(reassemblyTimeout),
+	}
+	p.messages[key] = msg
+	p.allBytes += len(buffer.Cap())
+	if p.nextExpire.IsZero() {
+		p.nextExpire = msg.deadline
+	}
+	return msg, true
+}
+
+func (p *reassembler) expire(now time.Time) {
+	p.nextExpire = time.Time{}
+	for key, msg := range p.messages {
+		if now.After(msg.deadline) {
+			p.stats.drop(IncompleteDropReason)
+			p.remove(key, msg)
+			msg.buffer.Release()
+			continue
+		}
+		if p.nextExpire.IsZero() || msg.deadline.Before(p.nextExpire) {
+			p.nextExpire = msg.deadline
+		}
+	}
+}
+
+func (p *reassembler) dropOldest() bool {
+	var (
+		oldestKey reassemblyKey
+		oldest    *reassembly
+	)
+	for key, msg := range p.messages {
+		if oldest == nil || msg.deadline.Before(oldest.deadline) {
+			oldestKey, oldest = key, msg
+		}
+	}
+	if oldest == nil {
+		return false
+	}
+	p.stats.drop(IncompleteDropReason)
+	p.remove(oldestKey, oldest)
+	oldest.buffer.Release()
+	return true
+}
+
+func (p *reassembler) remove(key reassemblyKey, msg *reassembly) {
+	delete(p.messages, key)
+	p.allBytes -= len(msg.buffer.Cap())
+}
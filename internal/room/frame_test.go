@@ -0,0 +1,175 @@
+package room
+
+import (
+	"testing"
+	"time"
+
+	"github.com/number571/clivekit/internal/pool"
+)
+
+func TestDecodeFrameHeader(t *testing.T) {
+	tests := []struct {
+		name   string
+		header frameHeader
+		size   int
+		ok     bool
+	}{
+		{"single", frameHeader{dataType: TextDataType, fragCount: 1}, 10, true},
+		{"last fragment", frameHeader{dataType: TextDataType, fragIndex: 1, fragCount: 2}, 10, true},
+		{"index out of range", frameHeader{dataType: TextDataType, fragIndex: 2, fragCount: 2}, 10, false},
+		{"no fragments", frameHeader{dataType: TextDataType}, 10, false},
+		{"unknown type", frameHeader{dataType: endDataType, fragCount: 1}, 10, false},
+		{"short middle fragment", frameHeader{dataType: TextDataType, fragCount: 2}, 10, false},
+		{"oversized fragment", frameHeader{dataType: TextDataType, fragCount: 1}, fragmentSize + 1, false},
+	}
+	for _, tt := range tests {
+		frame := make([]byte, frameHeaderSize+tt.size)
+		tt.header.encode(frame)
+		if _, ok := decodeFrameHeader(frame); ok != tt.ok {
+			t.Errorf("%s: got %v, want %v", tt.name, ok, tt.ok)
+		}
+	}
+	if _, ok := decodeFrameHeader(make([]byte, frameHeaderSize-1)); ok {
+		t.Error("short frame accepted")
+	}
+}
+
+type testFragment struct {
+	messageID uint32
+	fragIndex uint16
+	fragCount uint16
+	flags     uint8
+	size      int
+	// ages the partial messages past their deadline before the fragment
+	timeout bool
+}
+
+func TestReassembler(t *testing.T) {
+	const bigCount = 4 << 10 // 4 MiB messages, two fill the budget
+
+	tests := []struct {
+		name      string
+		buffSize  int
+		fragments []testFragment
+		completed int
+		drops     map[DropReason]uint64
+	}{
+		{
+			name:     "out of order",
+			buffSize: 1 << 16,
+			fragments: []testFragment{
+				{messageID: 1, fragIndex: 2, fragCount: 3, size: 10},
+				{messageID: 1, fragIndex: 0, fragCount: 3, size: fragmentSize},
+				{messageID: 1, fragIndex: 1, fragCount: 3, size: fragmentSize},
+			},
+			completed: 1,
+		},
+		{
+			name:     "index beyond buffer size",
+			buffSize: 2 * fragmentSize,
+			fragments: []testFragment{
+				{messageID: 1, fragIndex: 2, fragCount: 3, size: 10},
+			},
+			drops: map[DropReason]uint64{OversizeDropReason: 1},
+		},
+		{
+			name:     "duplicate",
+			buffSize: 1 << 16,
+			fragments: []testFragment{
+				{messageID: 1, fragIndex: 0, fragCount: 2, size: fragmentSize},
+				{messageID: 1, fragIndex: 0, fragCount: 2, size: fragmentSize},
+				{messageID: 1, fragIndex: 1, fragCount: 2, size: 10},
+				{messageID: 1, fragIndex: 1, fragCount: 2, size: 10},
+			},
+			// the late duplicate starts a new message, which stays partial
+			completed: 1,
+		},
+		{
+			name:     "mismatched header",
+			buffSize: 1 << 16,
+			fragments: []testFragment{
+				{messageID: 1, fragIndex: 0, fragCount: 3, size: fragmentSize},
+				{messageID: 1, fragIndex: 1, fragCount: 2, size: 10},
+				{messageID: 1, fragIndex: 1, fragCount: 3, flags: 1, size: fragmentSize},
+			},
+			drops: map[DropReason]uint64{BadFrameDropReason: 2},
+		},
+		{
+			name:     "budget eviction",
+			buffSize: bigCount * fragmentSize,
+			fragments: []testFragment{
+				{messageID: 1, fragIndex: 0, fragCount: bigCount, size: fragmentSize},
+				{messageID: 2, fragIndex: 0, fragCount: bigCount, size: fragmentSize},
+				{messageID: 3, fragIndex: 0, fragCount: bigCount, size: fragmentSize},
+				// the evicted message starts over
+				{messageID: 1, fragIndex: 1, fragCount: bigCount, size: fragmentSize},
+			},
+			drops: map[DropReason]uint64{IncompleteDropReason: 2},
+		},
+		{
+			name:     "timeout",
+			buffSize: 1 << 16,
+			fragments: []testFragment{
+				{messageID: 1, fragIndex: 0, fragCount: 2, size: fragmentSize},
+				{messageID: 2, fragIndex: 0, fragCount: 2, size: fragmentSize},
+				// a fragment of a known message expires the others too
+				{messageID: 2, fragIndex: 1, fragCount: 2, size: 10, timeout: true},
+			},
+			drops: map[DropReason]uint64{IncompleteDropReason: 2},
+		},
+	}
+
+	for _, tt := range tests {
+		var (
+			stats       = &roomStats{}
+			buffPool    = pool.NewBufferPool(pool.NewHeapAllocator(), 2*reassemblyMaxBytes)
+			reassembler = newReassembler(buffPool, tt.buffSize, stats)
+			completed   = 0
+		)
+		for _, f := range tt.fragments {
+			if f.timeout {
+				for _, msg := range reassembler.messages {
+					msg.deadline = time.Now().Add(-time.Millisecond)
+				}
+				reassembler.nextExpire = time.Now().Add(-time.Millisecond)
+			}
+			header := frameHeader{
+				dataType:  TextDataType,
+				flags:     f.flags,
+				messageID: f.messageID,
+				fragIndex: f.fragIndex,
+				fragCount: f.fragCount,
+			}
+			buffer, msgHeader, ok := reassembler.add("peer", header, make([]byte, f.size))
+			if !ok {
+				continue
+			}
+			if want := messageSize(tt.fragments, f.messageID); len(buffer.Bytes()) != want || msgHeader.messageID != f.messageID {
+				t.Errorf("%s: message %d of %d bytes, want %d", tt.name, msgHeader.messageID, len(buffer.Bytes()), want)
+			}
+			buffer.Release()
+			completed++
+		}
+
+		if completed != tt.completed {
+			t.Errorf("%s: %d messages completed, want %d", tt.name, completed, tt.completed)
+		}
+		for reason := DropReason(0); reason < endDropReason; reason++ {
+			if got := stats.drops[reason].Load(); got != tt.drops[reason] {
+				t.Errorf("%s: %d drops of reason %d, want %d", tt.name, got, reason, tt.drops[reason])
+			}
+		}
+		reassembler.close()
+		buffPool.Close()
+	}
+}
+
+// messageSize is the size of the whole message from its last fragment.
+func messageSize(fragments []testFragment, messageID uint32) int {
+	for _, f := range fragments {
+		if f.messageID == messageID && f.fragIndex+1 == f.fragCount {
+			return int(f.fragIndex)*fragmentSize + f.size
+		}
+	}
+	return 0
+}
@@ -0,0 +1,97 @@
+package room
+
+const (
+	nalTypeMask = 0x1f
+	nalTypeIDR  = 5
+	nalTypeSPS  = 7
+	nalTypePPS  = 8
+	nalTypeAUD  = 9
+
+	// appended to sealed NAL units, so that they never end with a zero byte
+	nalTrailer = 0x80
+)
+
+var (
+	annexBStartCode = []byte{0, 0, 0, 1}
+)
+
+// nextNALUnit returns the first NAL unit of an Annex-B stream without its
+// start code, and the rest of the stream.
+func nextNALUnit(stream []byte) ([]byte, []byte) {
+	begin := findStartCode(stream, 0)
+	if begin < 0 {
+		return nil, nil
+	}
+	begin += 3
+
+	end := findStartCode(stream, begin)
+	if end < 0 {
+		end = len(stream)
+	}
+
+	nal := stream[begin:end]
+	for len(nal) != 0 && nal[len(nal)-1] == 0 {
+		nal = nal[:len(nal)-1]
+	}
+	return nal, stream[end:]
+}
+
+func findStartCode(stream []byte, from int) int {
+	for i := from; i+2 < len(stream); i++ {
+		if stream[i+2] > 1 {
+			i += 2
+			continue
+		}
+		if stream[i] == 0 && stream[i+1] == 0 && stream[i+2] == 1 {
+			return i
+		}
+	}
+	return -1
+}
+
+// isClearNAL reports whether the NAL unit type is left unencrypted: the SFU
+// and decoders need parameter sets and delimiters to find keyframes.
+func isClearNAL(nalType byte) bool {
+	return nalType == nalTypeSPS || nalType == nalTypePPS || nalType == nalTypeAUD
+}
+
+// appendEscaped appends src with emulation prevention bytes, so that the
+// sealed data never forms a start code.
+func appendEscaped(dst, src []byte) []byte {
+	zeros := 0
+	for _, b := range src {
+		if zeros >= 2 && b <= 3 {
+			dst = append(dst, 3)
+			zeros = 0
+		}
+		dst = append(dst, b)
+		if b == 0 {
+			zeros++
+		} else {
+			zeros = 0
+		}
+	}
+	return dst
+}
+
+// unescapeInPlace removes emulation prevention bytes from b.
+func unescapeInPlace(b []byte) []byte {
+	var (
+		n     = 0
+		zeros = 0
+	)
+	for _, c := range b {
+		if zeros >= 2 && c == 3 {
+			zeros = 0
+			continue
+		}
+		b[n] = c
+		n++
+		if c == 0 {
+			zeros++
+		} else {
+			zeros = 0
+		}
+	}
+	return b[:n]
+}
@@ -0,0 +1,56 @@
+package room
+
+import (
+	"bytes"
+	"math/rand"
+	"testing"
+)
+
+func TestEscapeRoundTrip(t *testing.T) {
+	tests := [][]byte{
+		{},
+		{0, 0, 0},
+		{0, 0, 1},
+		{0, 0, 2},
+		{0, 0, 3},
+		{0, 0, 3, 0, 0, 3},
+		{0, 0, 0, 0, 0, 1, 0, 0},
+		{1, 0, 0, 4, 0, 0},
+	}
+	rnd := rand.New(rand.NewSource(1))
+	for i := 0; i < 100; i++ {
+		// mostly zeros and small values, so escapes are frequent
+		b := make([]byte, rnd.Intn(64))
+		for j := range b {
+			b[j] = byte(rnd.Intn(5)) * byte(rnd.Intn(2))
+		}
+		tests = append(tests, b)
+	}
+
+	for _, src := range tests {
+		escaped := appendEscaped(nil, src)
+		// with the trailer, no start code can form in or after the data
+		if findStartCode(append(escaped, nalTrailer), 0) >= 0 {
+			t.Fatalf("%v escaped to %v with a start code", src, escaped)
+		}
+		if got := unescapeInPlace(escaped); !bytes.Equal(got, src) {
+			t.Fatalf("%v unescaped to %v", src, got)
+		}
+	}
+}
+
+func TestNextNALUnit(t *testing.T) {
+	stream := []byte{0, 0, 0, 1, 0x67, 1, 0, 0, 1, 0x68, 2, 0, 0, 0, 1, 0x65, 3}
+	want := [][]byte{{0x67, 1}, {0x68, 2}, {0x65, 3}}
+
+	for _, w := range want {
+		var nal []byte
+		nal, stream = nextNALUnit(stream)
+		if !bytes.Equal(nal, w) {
+			t.Fatalf("got %v, want %v", nal, w)
+		}
+	}
+	if nal, _ := nextNALUnit(stream); nal != nil {
+		t.Fatalf("got %v after the last unit", nal)
+	}
+}
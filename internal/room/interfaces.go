@@ -2,14 +2,17 @@ package room
 
 import (
 	"context"
+	"time"
 
+	lksdk "github.com/livekit/server-sdk-go/v2"
+	"github.com/number571/clivekit/internal/compress"
 	"github.com/number571/clivekit/internal/crypto"
 )
 
 type IRoomManager interface {
 	Get([]byte) (IRoom, bool)
-	Set([]byte, IRoom) bool
-	Del([]byte)
+	Add([]byte, IRoom) bool
+	Del([]byte) (IRoom, bool)
 }
 
 type ISecureRoom interface {
@@ -18,9 +21,46 @@ type ISecureRoom interface {
 	GetCipherManager() crypto.ICipherManager
 }
 
+// ITransport carries the sealed frames and tracks of a room.
+type ITransport interface {
+	PublishData([]byte, bool, []string) error
+	PublishTrack(*lksdk.LocalTrack, *lksdk.TrackPublicationOptions) (string, error)
+	UnpublishTrack(string) error
+	Disconnect()
+}
+
 type IRoom interface {
 	Close()
+	GetConnectState() ConnectState
+	GetReadyFD() (int, error)
+	GetStats() Stats
+	DropLoopbackLink() error
 
 	ReceiveDataPacket(context.Context) (*DataPacket, error)
+	ReceiveDataPackets(context.Context, []*DataPacket, int) (int, error)
 	PublishDataPacket(context.Context, *DataPacket) error
+	PublishDataVector(context.Context, DataType, [][]byte) error
+	SetDataHandler(DataType, DataHandler)
+	SetSubscription(DataTypeMask, []string)
+	SetCompression(DataType, compress.Codec) error
+
+	EnqueueDataPacket(context.Context, *DataPacket) error
+	TryEnqueueDataPacket(*DataPacket) error
+	TryEnqueueDataPackets([]*DataPacket) error
+	SetSendPolicy(DataType, QueuePolicy)
+	GetSendQueueState() SendQueueState
+
+	PublishAudioTrack(AudioFormat, int) error
+	WriteAudioFrames([]byte) error
+	EnqueueAudioData(context.Context, AudioFormat, []byte) error
+	GetAudioTrackFormat() (AudioFormat, bool)
+	UnpublishAudioTrack() error
+	SubscribeAudio(AudioFormat, bool) error
+	GetAudioSubscription() (AudioFormat, bool)
+	PullAudio(string, []byte) (int, bool)
+
+	PublishVideoTrack(VideoFormat) error
+	WriteVideoFrame([]byte, time.Duration) error
+	UnpublishVideoTrack() error
+	SubscribeVideo(bool)
 }
@@ -0,0 +1,256 @@
+package room
+
+import (
+	"sync"
+	"time"
+
+	"github.com/number571/clivekit/internal/audio"
+	"github.com/number571/clivekit/internal/pool"
+)
+
+const (
+	jitterSlots      = 64 // 1.28s of 20ms frames
+	minPlayoutDelay  = 40 * time.Millisecond
+	maxPlayoutDelay  = 400 * time.Millisecond
+	maxConcealFrames = 5
+	// frames over the target delay before playout skips ahead
+	playoutSlackFrames = 2
+)
+
+type jitterSlot struct {
+	seq    uint16
+	buffer *pool.Buffer
+	frame  []byte
+}
+
+// jitterBuffer is the playout buffer of one audio sender. It orders Opus
+// frames by sequence number and plays them out after a delay which follows
+// the measured interarrival jitter (RFC 3550). A missing frame is recovered
+// from the in-band FEC of the next one or concealed by the decoder.
+type jitterBuffer struct {
+	mtx       *sync.Mutex
+	format    AudioFormat
+	decoder   audio.IDecoder
+	resampler audio.IResampler
+	stats     *roomStats
+	closed    bool
+
+	slots     [jitterSlots]jitterSlot
+	started   bool
+	playing   bool
+	nextSeq   uint16
+	highSeq   uint16
+	concealed int
+
+	epoch       time.Time
+	jitter      float64 // in RTP clock units
+	lastTransit int64
+	hasTransit  bool
+
+	pcm       []float32
+	resampled []float32
+	pending   []float32
+}
+
+func newJitterBuffer(format AudioFormat, stats *roomStats) (*jitterBuffer, error) {
+	decoder, resampler, err := newAudioDecoder(format)
+	if err != nil {
+		return nil, err
+	}
+	return &jitterBuffer{
+		mtx:       &sync.Mutex{},
+		format:    format,
+		decoder:   decoder,
+		resampler: resampler,
+		stats:     stats,
+		epoch:     time.Now(),
+		pcm:       make([]float32, maxDecodedFrameSize*format.Channels),
+	}, nil
+}
+
+// push takes ownership of the buffer holding the opened Opus frame.
+func (p *jitterBuffer) push(seq uint16, timestamp uint32, buffer *pool.Buffer, frame []byte) {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	if p.closed {
+		buffer.Release()
+		return
+	}
+	p.updateJitter(timestamp)
+
+	if !p.started {
+		p.started, p.nextSeq, p.highSeq = true, seq, seq-1
+	}
+
+	ahead := int16(seq - p.nextSeq)
+	if ahead < 0 {
+		p.stats.drop(LateDropReason)
+		buffer.Release()
+		return
+	}
+	if int(ahead) >= jitterSlots {
+		// the stream jumped, e.g. after a long pause of the sender
+		p.releaseSlots()
+		p.playing, p.nextSeq, p.highSeq = false, seq, seq-1
+	}
+
+	slot := &p.slots[seq%jitterSlots]
+	if slot.buffer != nil {
+		if slot.seq == seq {
+			buffer.Release()
+			return
+		}
+		slot.buffer.Release()
+	}
+	*slot = jitterSlot{seq: seq, buffer: buffer, frame: frame}
+
+	if int16(seq-p.highSeq) > 0 {
+		p.highSeq = seq
+	}
+}
+
+// pull fills out with interleaved samples in the format of the buffer and
+// returns the number of frames which came from the sender. The rest of out
+// is silence.
+func (p *jitterBuffer) pull(out []byte) int {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	var (
+		sampleFormat = p.format.SampleFormat
+		sampleSize   = sampleFormat.Size()
+		n            = 0
+	)
+	for n < len(out)/sampleSize {
+		if len(p.pending) == 0 && !p.nextFrame() {
+			break
+		}
+		c := audio.Convert(out[n*sampleSize:], sampleFormat, audio.Bytes(p.pending), audio.F32)
+		p.pending = p.pending[c:]
+		n += c
+	}
+	clear(out[n*sampleSize:])
+
+	return n / p.format.Channels
+}
+
+func (p *jitterBuffer) close() {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	p.closed = true
+	p.releaseSlots()
+	p.decoder.Close()
+	if p.resampler != nil {
+		p.resampler.Close()
+	}
+}
+
+func (p *jitterBuffer) updateJitter(timestamp uint32) {
+	arrival := int64(time.Since(p.epoch) * audio.SampleRate / time.Second)
+	transit := arrival - int64(timestamp)
+	if p.hasTransit {
+		d := transit - p.lastTransit
+		if d < 0 {
+			d = -d
+		}
+		p.jitter += (float64(d) - p.jitter) / 16
+	}
+	p.lastTransit, p.hasTransit = transit, true
+}
+
+// targetFrames is the playout delay in frames: three times the jitter on
+// top of one frame.
+func (p *jitterBuffer) targetFrames() int {
+	delay := audio.FrameDuration + time.Duration(3*p.jitter*float64(time.Second)/audio.SampleRate)
+	delay = max(minPlayoutDelay, min(maxPlayoutDelay, delay))
+	return int((delay + audio.FrameDuration - 1) / audio.FrameDuration)
+}
+
+// buffered counts the frames from the next one to play to the newest one.
+func (p *jitterBuffer) buffered() int {
+	if !p.started {
+		return 0
+	}
+	return max(0, int(int16(p.highSeq-p.nextSeq))+1)
+}
+
+// nextFrame decodes the next frame into pending.
+func (p *jitterBuffer) nextFrame() bool {
+	if p.closed || !p.started {
+		return false
+	}
+
+	target := p.targetFrames()
+	if !p.playing {
+		if p.buffered() < target {
+			return false
+		}
+		p.playing = true
+	}
+	for p.buffered() > target+playoutSlackFrames {
+		p.stats.drop(LateDropReason)
+		p.releaseSlot(p.nextSeq)
+		p.nextSeq++
+	}
+
+	var (
+		n     int
+		err   error
+		slot  = &p.slots[p.nextSeq%jitterSlots]
+		next  = &p.slots[(p.nextSeq+1)%jitterSlots]
+		frame = p.pcm[:audio.FrameSize*p.format.Channels]
+	)
+	switch {
+	case slot.buffer != nil && slot.seq == p.nextSeq:
+		n, err = p.decoder.Decode(p.pcm, slot.frame)
+		p.releaseSlot(p.nextSeq)
+		p.concealed = 0
+	case next.buffer != nil && next.seq == p.nextSeq+1:
+		n, err = p.decoder.DecodeFEC(frame, next.frame)
+		p.concealed++
+	case p.buffered() > 0 || p.concealed < maxConcealFrames:
+		n, err = p.decoder.Decode(frame, nil)
+		p.concealed++
+	default:
+		// the sender paused or the network stalled: buffer again and
+		// resume right after the newest frame
+		p.playing, p.nextSeq = false, p.highSeq+1
+		return false
+	}
+	p.nextSeq++
+
+	if err != nil {
+		n = audio.FrameSize
+		clear(p.pcm[:n*p.format.Channels])
+	}
+
+	p.pending = p.pcm[:n*p.format.Channels]
+	if p.resampler != nil {
+		p.resampled, err = p.resampler.Resample(p.resampled[:0], p.pending)
+		if err != nil {
+			return false
+		}
+		p.pending = p.resampled
+	}
+	return true
+}
+
+func (p *jitterBuffer) releaseSlot(seq uint16) {
+	slot := &p.slots[seq%jitterSlots]
+	if slot.buffer == nil || slot.seq != seq {
+		return
+	}
+	slot.buffer.Release()
+	*slot = jitterSlot{}
+}
+
+func (p *jitterBuffer) releaseSlots() {
+	for i := range p.slots {
+		if p.slots[i].buffer != nil {
+			p.slots[i].buffer.Release()
+			p.slots[i] = jitterSlot{}
+		}
+	}
+}
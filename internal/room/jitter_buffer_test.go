@@ -0,0 +1,109 @@
+package room
+
+import (
+	"fmt"
+	"strings"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/number571/clivekit/internal/audio"
+	"github.com/number571/clivekit/internal/pool"
+)
+
+// fakeDecoder logs what it decodes: "d<frame>" for a frame, "fec<frame>"
+// for a frame recovered from the next one and "plc" for concealment.
+type fakeDecoder struct {
+	log []string
+}
+
+func (p *fakeDecoder) Decode(pcm []float32, packet []byte) (int, error) {
+	if packet == nil {
+		p.log = append(p.log, "plc")
+	} else {
+		p.log = append(p.log, fmt.Sprintf("d%d", packet[0]))
+	}
+	clear(pcm[:audio.FrameSize])
+	return audio.FrameSize, nil
+}
+
+func (p *fakeDecoder) DecodeFEC(pcm []float32, packet []byte) (int, error) {
+	p.log = append(p.log, fmt.Sprintf("fec%d", packet[0]))
+	clear(pcm)
+	return len(pcm), nil
+}
+
+func (p *fakeDecoder) Close() {}
+
+func TestJitterBuffer(t *testing.T) {
+	var (
+		decoder = &fakeDecoder{}
+		stats   = &roomStats{}
+		frames  = pool.NewBufferPool(pool.NewHeapAllocator(), 1<<20)
+		format  = AudioFormat{SampleRate: audio.SampleRate, Channels: 1, SampleFormat: audio.F32}
+		out     = make([]byte, audio.FrameSize*format.SampleFormat.Size())
+	)
+	defer frames.Close()
+
+	jb := &jitterBuffer{
+		mtx:     &sync.Mutex{},
+		format:  format,
+		decoder: decoder,
+		stats:   stats,
+		epoch:   time.Now(),
+		pcm:     make([]float32, maxDecodedFrameSize),
+	}
+	defer jb.close()
+
+	// equal timestamps keep the jitter at zero, so the target delay is
+	// the minimum of two frames
+	push := func(seqs ...uint16) {
+		for _, seq := range seqs {
+			buffer, _ := frames.Get(1)
+			buffer.Bytes()[0] = byte(seq)
+			jb.push(seq, 0, buffer, buffer.Bytes())
+		}
+	}
+	pull := func(n int) string {
+		decoder.log = decoder.log[:0]
+		for i := 0; i < n; i++ {
+			jb.pull(out)
+		}
+		return strings.Join(decoder.log, " ")
+	}
+
+	// nothing plays out before the target delay is buffered
+	push(10)
+	if got := pull(1); got != "" {
+		t.Fatalf("before the target delay: %q", got)
+	}
+
+	// reordered frames play in order, a duplicate is ignored
+	push(12, 11, 11)
+	if got, want := pull(3), "d10 d11 d12"; got != want {
+		t.Fatalf("reorder: got %q, want %q", got, want)
+	}
+
+	// a lost frame is recovered from the FEC of the next one
+	push(13, 15, 16)
+	if got, want := pull(4), "d13 fec15 d15 d16"; got != want {
+		t.Fatalf("fec: got %q, want %q", got, want)
+	}
+
+	// then a few frames are concealed before playout waits again
+	if got, want := pull(maxConcealFrames+2), strings.TrimSpace(strings.Repeat("plc ", maxConcealFrames)); got != want {
+		t.Fatalf("conceal: got %q, want %q", got, want)
+	}
+
+	// a frame older than the playout position is late
+	push(5)
+	if drops := stats.drops[LateDropReason].Load(); drops != 1 {
+		t.Fatalf("%d late drops", drops)
+	}
+
+	// a jump of the stream resets the buffer to the new position
+	push(200, 201)
+	if got, want := pull(2), "d200 d201"; got != want {
+		t.Fatalf("reset: got %q, want %q", got, want)
+	}
+}
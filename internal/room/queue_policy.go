@@ -0,0 +1,17 @@
+package room
+
+// QueuePolicy selects what happens to a message which does not fit into a
+// full queue.
+type QueuePolicy int
+
+const (
+	// BlockQueuePolicy makes the producer wait for free space in the queue.
+	// Receive queues can not wait for the network and use the default
+	// policy of the data type instead.
+	BlockQueuePolicy QueuePolicy = iota
+	// DropOldestQueuePolicy evicts the oldest queued message of the same
+	// type, or rejects the new one when there is none.
+	DropOldestQueuePolicy
+	// DropNewestQueuePolicy rejects the new message.
+	DropNewestQueuePolicy
+)
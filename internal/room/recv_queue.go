@@ -0,0 +1,266 @@
+package room
+
+import (
+	"context"
+	"sync"
+	"sync/atomic"
+)
+
+const (
+	defaultRecvQueueDepth  = 2048
+	defaultRecvQueueBudget = 8 << 20
+)
+
+var (
+	// strict priority order, used when no weights are configured
+	recvPriorities = [...]DataType{
+		SignalDataType,
+		AudioDataType,
+		TextDataType,
+		CustomDataType,
+		VideoDataType,
+	}
+)
+
+type RecvQueueConfig struct {
+	// Depth is the maximum number of queued messages of the type.
+	Depth int
+	// Policy is applied when the type is at its depth, or when the room is
+	// out of its byte budget and no lower priority message can be evicted.
+	Policy QueuePolicy
+	// Weight enables weighted round robin between the types when set for
+	// any of them. Otherwise reads follow strict priority:
+	// signal, audio, text, custom, video.
+	Weight int
+}
+
+type packetRing struct {
+	items  []*DataPacket
+	head   int
+	length int
+}
+
+// recvQueue holds received messages in one queue per data type under a
+// common byte budget.
+type recvQueue struct {
+	mtx      *sync.Mutex
+	signal   chan struct{}
+	closed   bool
+	weighted bool
+	configs  [endDataType]RecvQueueConfig
+	rings    [endDataType]packetRing
+	current  [endDataType]int
+	budget   int
+	bytes    int
+	maxLen   int
+	length   atomic.Int32
+	stats    *roomStats
+}
+
+func newRecvQueue(configs []RecvQueueConfig, budget int, stats *roomStats) *recvQueue {
+	if budget <= 0 {
+		budget = defaultRecvQueueBudget
+	}
+	q := &recvQueue{
+		mtx:    &sync.Mutex{},
+		signal: make(chan struct{}, 1),
+		budget: budget,
+		stats:  stats,
+	}
+	for t := DataType(0); t < endDataType; t++ {
+		var cfg RecvQueueConfig
+		if int(t) < len(configs) {
+			cfg = configs[t]
+		}
+		if cfg.Depth <= 0 {
+			cfg.Depth = defaultRecvQueueDepth
+		}
+		if cfg.Policy == BlockQueuePolicy {
+			cfg.Policy = DropNewestQueuePolicy
+			if t == AudioDataType {
+				cfg.Policy = DropOldestQueuePolicy
+			}
+		}
+		if cfg.Weight > 0 {
+			q.weighted = true
+		}
+		q.configs[t] = cfg
+		q.rings[t].items = make([]*DataPacket, cfg.Depth)
+	}
+	if q.weighted {
+		for t := range q.configs {
+			if q.configs[t].Weight <= 0 {
+				q.configs[t].Weight = 1
+			}
+		}
+	}
+	return q
+}
+
+func (p *recvQueue) len() int {
+	return int(p.length.Load())
+}
+
+// load reports the current and the highest number of queued messages and
+// the queued bytes.
+func (p *recvQueue) load(dst *Stats) {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	dst.QueueLength = p.len()
+	dst.QueueHighWater = p.maxLen
+	dst.QueueBytes = p.bytes
+}
+
+// push takes ownership of dp. It returns false when dp was dropped.
+func (p *recvQueue) push(dp *DataPacket) bool {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	if p.closed {
+		p.stats.drop(ClosedDropReason)
+		dp.Release()
+		return false
+	}
+
+	var (
+		ring   = &p.rings[dp.Type]
+		policy = p.configs[dp.Type].Policy
+		size   = len(dp.Payload)
+	)
+	if size > p.budget {
+		p.stats.drop(QueueFullDropReason)
+		dp.Release()
+		return false
+	}
+	for ring.length == len(ring.items) || p.bytes+size > p.budget {
+		p.stats.drop(QueueFullDropReason)
+		// out of budget, the messages of lower priority types go first
+		if ring.length != len(ring.items) {
+			if lower := p.lowerRing(dp.Type); lower != nil {
+				p.popRing(lower).Release()
+				continue
+			}
+		}
+		if policy != DropOldestQueuePolicy || ring.length == 0 {
+			dp.Release()
+			return false
+		}
+		old := p.popRing(ring)
+		old.Release()
+	}
+
+	ring.items[(ring.head+ring.length)%len(ring.items)] = dp
+	ring.length++
+	p.bytes += size
+	if n := int(p.length.Add(1)); n > p.maxLen {
+		p.maxLen = n
+	}
+
+	select {
+	case p.signal <- struct{}{}:
+	default:
+	}
+	return true
+}
+
+// pop waits for the next message in priority order until ctx is done.
+func (p *recvQueue) pop(ctx context.Context) (*DataPacket, error) {
+	for {
+		dp, ok, closed := p.tryPop()
+		if ok {
+			return dp, nil
+		}
+		if closed {
+			return nil, ErrClosedChannel
+		}
+		select {
+		case <-ctx.Done():
+			return nil, ctx.Err()
+		case <-p.signal:
+		}
+	}
+}
+
+func (p *recvQueue) tryPop() (*DataPacket, bool, bool) {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	ring := p.nextRing()
+	if ring == nil {
+		return nil, false, p.closed
+	}
+	dp := p.popRing(ring)
+
+	// wake the next reader, if there is more to read
+	if p.length.Load() != 0 {
+		select {
+		case p.signal <- struct{}{}:
+		default:
+		}
+	}
+	return dp, true, false
+}
+
+func (p *recvQueue) close() {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	p.closed = true
+	for t := range p.rings {
+		for p.rings[t].length != 0 {
+			p.popRing(&p.rings[t]).Release()
+		}
+	}
+	close(p.signal)
+}
+
+func (p *recvQueue) nextRing() *packetRing {
+	if !p.weighted {
+		for _, t := range recvPriorities {
+			if p.rings[t].length != 0 {
+				return &p.rings[t]
+			}
+		}
+		return nil
+	}
+
+	// smooth weighted round robin over the non-empty types
+	best, total := -1, 0
+	for t := range p.rings {
+		if p.rings[t].length == 0 {
+			continue
+		}
+		p.current[t] += p.configs[t].Weight
+		total += p.configs[t].Weight
+		if best < 0 || p.current[t] > p.current[best] {
+			best = t
+		}
+	}
+	if best < 0 {
+		return nil
+	}
+	p.current[best] -= total
+	return &p.rings[best]
+}
+
+// lowerRing returns the non-empty ring of the lowest priority type below
+// dataType in the strict priority order.
+func (p *recvQueue) lowerRing(dataType DataType) *packetRing {
+	for i := len(recvPriorities) - 1; i >= 0 && recvPriorities[i] != dataType; i-- {
+		if ring := &p.rings[recvPriorities[i]]; ring.length != 0 {
+			return ring
+		}
+	}
+	return nil
+}
+
+func (p *recvQueue) popRing(ring *packetRing) *DataPacket {
+	dp := ring.items[ring.head]
+	ring.items[ring.head] = nil
+	ring.head = (ring.head + 1) % len(ring.items)
+	ring.length--
+	p.bytes -= len(dp.Payload)
+	p.length.Add(-1)
+	return dp
+}
@@ -0,0 +1,95 @@
+package room
+
+import (
+	"context"
+	"testing"
+)
+
+func TestRecvQueuePriority(t *testing.T) {
+	queue := newRecvQueue(nil, 0, &roomStats{})
+	defer queue.close()
+
+	for _, dataType := range []DataType{VideoDataType, TextDataType, AudioDataType, SignalDataType} {
+		queue.push(newPooledDataPacket(dataType, "", nil, nil))
+	}
+	for _, want := range []DataType{SignalDataType, AudioDataType, TextDataType, VideoDataType} {
+		dp, err := queue.pop(context.Background())
+		if err != nil {
+			t.Fatal(err)
+		}
+		if dp.Type != want {
+			t.Fatalf("got type %d, want %d", dp.Type, want)
+		}
+		dp.Release()
+	}
+}
+
+func TestRecvQueueBudgetEviction(t *testing.T) {
+	queue := newRecvQueue(nil, 4<<10, &roomStats{})
+	defer queue.close()
+
+	video := make([]byte, 1<<10)
+	for i := 0; i < 4; i++ {
+		if !queue.push(newPooledDataPacket(VideoDataType, "", video, nil)) {
+			t.Fatal("video")
+		}
+	}
+	// video fills the budget, so a signal and audio message evict it
+	for _, dataType := range []DataType{SignalDataType, AudioDataType} {
+		if !queue.push(newPooledDataPacket(dataType, "", make([]byte, 100), nil)) {
+			t.Fatalf("type %d dropped", dataType)
+		}
+	}
+	// video does not evict messages of higher priority
+	if queue.push(newPooledDataPacket(VideoDataType, "", make([]byte, 4<<10), nil)) {
+		t.Fatal("oversized video queued")
+	}
+
+	for _, want := range []DataType{SignalDataType, AudioDataType, VideoDataType, VideoDataType} {
+		dp, ok, _ := queue.tryPop()
+		if !ok || dp.Type != want {
+			t.Fatalf("got %v, want type %d", dp, want)
+		}
+		dp.Release()
+	}
+}
+
+func BenchmarkRecvQueuePushPop(b *testing.B) {
+	queue := newRecvQueue(nil, 0, &roomStats{})
+	defer queue.close()
+
+	payload := make([]byte, 1024)
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		queue.push(newPooledDataPacket(TextDataType, "a", payload, nil))
+		dp, ok, _ := queue.tryPop()
+		if !ok {
+			b.Fatal("pop")
+		}
+		dp.Release()
+	}
+}
+
+// BenchmarkRecvQueueDrain measures reads of a queue which already holds a
+// burst of messages of several types.
+func BenchmarkRecvQueueDrain(b *testing.B) {
+	const burst = 256
+	queue := newRecvQueue(nil, 0, &roomStats{})
+	defer queue.close()
+
+	payload := make([]byte, 1024)
+	types := []DataType{TextDataType, AudioDataType, VideoDataType, SignalDataType}
+	b.ReportAllocs()
+	for i := 0; i < b.N; i += burst {
+		for j := 0; j < burst; j++ {
+			queue.push(newPooledDataPacket(types[j%len(types)], "a", payload, nil))
+		}
+		for j := 0; j < burst; j++ {
+			dp, ok, _ := queue.tryPop()
+			if !ok {
+				b.Fatal("pop")
+			}
+			dp.Release()
+		}
+	}
+}
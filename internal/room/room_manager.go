@@ -1,53 +1,120 @@
 package room
 
 import (
-	"encoding/hex"
+	"crypto/rand"
+	"encoding/binary"
 	"sync"
+	"sync/atomic"
 )
 
+const (
+	// DescSize is the size of a room descriptor:
+	// slot index (4 bytes) || slot generation (4 bytes) || random tag (8 bytes)
+	DescSize = 16
+
+	roomSlotsSize = 4096
+)
+
+type roomEntry struct {
+	gen  uint32
+	tag  uint64
+	room IRoom
+}
+
+// roomManager resolves descriptors through a fixed table of slots. Get does
+// a single atomic load and never allocates; a descriptor of a removed room
+// is rejected by the generation and tag stored in the slot.
 type roomManager struct {
-	mtx   *sync.RWMutex
-	rooms map[string]IRoom
+	mtx   *sync.Mutex
+	slots [roomSlotsSize]atomic.Pointer[roomEntry]
+	gens  [roomSlotsSize]uint32
+	free  []uint32
 }
 
 func NewRoomManager() IRoomManager {
+	free := make([]uint32, 0, roomSlotsSize)
+	for i := roomSlotsSize - 1; i >= 0; i-- {
+		free = append(free, uint32(i))
+	}
 	return &roomManager{
-		mtx:   &sync.RWMutex{},
-		rooms: make(map[string]IRoom, 64),
+		mtx:  &sync.Mutex{},
+		free: free,
 	}
 }
 
-func (p *roomManager) Get(k []byte) (IRoom, bool) {
-	p.mtx.RLock()
-	defer p.mtx.RUnlock()
-
-	return p.getRoom(k)
+func (p *roomManager) Get(desc []byte) (IRoom, bool) {
+	entry, _, ok := p.getEntry(desc)
+	if !ok {
+		return nil, false
+	}
+	return entry.room, true
 }
 
-func (p *roomManager) Set(k []byte, r IRoom) bool {
+// Add stores the room in a free slot and writes its descriptor into desc.
+func (p *roomManager) Add(desc []byte, r IRoom) bool {
+	if len(desc) < DescSize {
+		return false
+	}
+
+	var tag [8]byte
+	if _, err := rand.Read(tag[:]); err != nil {
+		return false
+	}
+
 	p.mtx.Lock()
 	defer p.mtx.Unlock()
 
-	if _, ok := p.getRoom(k); ok {
+	if len(p.free) == 0 {
 		return false
 	}
+	index := p.free[len(p.free)-1]
+	p.free = p.free[:len(p.free)-1]
+
+	p.gens[index]++
+	entry := &roomEntry{
+		gen:  p.gens[index],
+		tag:  binary.LittleEndian.Uint64(tag[:]),
+		room: r,
+	}
+	p.slots[index].Store(entry)
 
-	p.rooms[encode(k)] = r
+	binary.LittleEndian.PutUint32(desc[0:4], index)
+	binary.LittleEndian.PutUint32(desc[4:8], entry.gen)
+	binary.LittleEndian.PutUint64(desc[8:16], entry.tag)
 	return true
 }
 
-func (p *roomManager) Del(k []byte) {
-	p.mtx.Lock()
-	defer p.mtx.Unlock()
+// Del removes the room and returns it. Only one of concurrent callers with
+// the same descriptor gets the room.
+func (p *roomManager) Del(desc []byte) (IRoom, bool) {
+	entry, index, ok := p.getEntry(desc)
+	if !ok {
+		return nil, false
+	}
+	if !p.slots[index].CompareAndSwap(entry, nil) {
+		return nil, false
+	}
 
-	delete(p.rooms, encode(k))
-}
+	p.mtx.Lock()
+	p.free = append(p.free, index)
+	p.mtx.Unlock()
 
-func (p *roomManager) getRoom(k []byte) (IRoom, bool) {
-	room, ok := p.rooms[encode(k)]
-	return room, ok
+	return entry.room, true
 }
 
-func encode(k []byte) string {
-	return hex.EncodeToString(k)
+func (p *roomManager) getEntry(desc []byte) (*roomEntry, uint32, bool) {
+	if len(desc) < DescSize {
+		return nil, 0, false
+	}
+	index := binary.LittleEndian.Uint32(desc[0:4])
+	if index >= roomSlotsSize {
+		return nil, 0, false
+	}
+	entry := p.slots[index].Load()
+	if entry == nil ||
+		entry.gen != binary.LittleEndian.Uint32(desc[4:8]) ||
+		entry.tag != binary.LittleEndian.Uint64(desc[8:16]) {
+		return nil, 0, false
+	}
+	return entry, index, true
 }
@@ -0,0 +1,72 @@
+package room
+
+import (
+	"testing"
+)
+
+func TestRoomManagerStaleDesc(t *testing.T) {
+	manager := NewRoomManager()
+	desc := make([]byte, DescSize)
+	if !manager.Add(desc, nil) {
+		t.Fatal("add")
+	}
+	if _, ok := manager.Get(desc); !ok {
+		t.Fatal("get")
+	}
+	if _, ok := manager.Del(desc); !ok {
+		t.Fatal("del")
+	}
+	if _, ok := manager.Get(desc); ok {
+		t.Fatal("stale descriptor resolved")
+	}
+
+	// the slot is reused with a new generation
+	fresh := make([]byte, DescSize)
+	if !manager.Add(fresh, nil) {
+		t.Fatal("add again")
+	}
+	if _, ok := manager.Get(desc); ok {
+		t.Fatal("stale descriptor resolved after reuse")
+	}
+}
+
+func BenchmarkRoomManagerGet(b *testing.B) {
+	manager := NewRoomManager()
+	desc := make([]byte, DescSize)
+	if !manager.Add(desc, nil) {
+		b.Fatal("add")
+	}
+	b.ReportAllocs()
+	b.RunParallel(func(pb *testing.PB) {
+		for pb.Next() {
+			if _, ok := manager.Get(desc); !ok {
+				b.Fatal("get")
+			}
+		}
+	})
+}
+
+func BenchmarkRoomManagerGetMiss(b *testing.B) {
+	manager := NewRoomManager()
+	desc := make([]byte, DescSize)
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		if _, ok := manager.Get(desc); ok {
+			b.Fatal("get")
+		}
+	}
+}
+
+func BenchmarkRoomManagerAddDel(b *testing.B) {
+	manager := NewRoomManager()
+	desc := make([]byte, DescSize)
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		if !manager.Add(desc, nil) {
+			b.Fatal("add")
+		}
+		if _, ok := manager.Del(desc); !ok {
+			b.Fatal("del")
+		}
+	}
+}
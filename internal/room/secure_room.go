@@ -2,12 +2,41 @@ package room
 
 import (
 	"context"
-	"fmt"
-	"strconv"
+	"runtime"
+	"slices"
+	"strings"
 	"sync"
+	"sync/atomic"
+	"time"
 
 	lksdk "github.com/livekit/server-sdk-go/v2"
+	"github.com/number571/clivekit/internal/compress"
 	"github.com/number571/clivekit/internal/crypto"
+	"github.com/number571/clivekit/internal/loopback"
+	"github.com/number571/clivekit/internal/notify"
+	"github.com/number571/clivekit/internal/pool"
+	"github.com/pion/webrtc/v4"
+)
+
+const (
+	keyIDSize    = 1
+	dataTypeSize = 1
+	sendPoolSize = 16 << 20
+
+	defaultSealParallelThreshold = 32 << 10
+	// a sealing goroutine takes at least this many fragments, fewer are
+	// not worth starting it
+	sealWorkerFragments = 8
+)
+
+var (
+	// transports copy the payload before PublishData returns, so
+	// sealed buffers can be reused right after publishing
+	sealedPool = sync.Pool{New: func() any { return &sealedMessage{} }}
+
+	// messages of at least this size are sealed on several cores, 0 is
+	// the default and a negative value turns it off
+	sealParallelThreshold atomic.Int64
 )
 
 var (
@@ -16,47 +45,118 @@ var (
 
 type secureRoom struct {
 	mtx           *sync.RWMutex
-	lksdkRoom     *lksdk.Room
 	buffSize      int
 	closed        chan struct{}
-	dataPackCh    chan *DataPacket
+	recvQueue     *recvQueue
+	buffPool      pool.IPool
+	reassembler   *reassembler
+	deliverer     *deliverer
 	cipherManager crypto.ICipherManager
+	subscription  atomic.Pointer[subscription]
+	compression   *compression
+	shardSalt     uint64
+	stats         *roomStats
+	// received frames being opened, on decrypt workers or transports
+	opening *sync.WaitGroup
+
+	sendPool   pool.IPool
+	sendQueue  *sendQueue
+	sendWorker chan struct{}
+
+	// message split across chunked reads
+	readMtx    *sync.Mutex
+	pending    *DataPacket
+	pendingOff int
+	hasPending atomic.Bool
+
+	// connection, replaced when the room reconnects
+	connInfo     *ConnectInfo
+	transport    atomic.Pointer[ITransport]
+	stateMtx     *sync.Mutex
+	stateCond    *sync.Cond
+	state        ConnectState
+	transportGen uint64
+	reconnecting bool
+	stateChanged atomic.Bool
+	closing      chan struct{}
+	connector    *sync.WaitGroup
+
+	// readiness descriptor, created on first request
+	notifyMtx *sync.Mutex
+	notifier  atomic.Pointer[notify.INotifier]
+
+	// media tracks
+	audioMtx          *sync.Mutex
+	audioPublisher    *audioPublisher
+	audioSubscription atomic.Pointer[audioSubscription]
+	playoutMtx        *sync.RWMutex
+	playouts          map[string]*jitterBuffer
+	videoMtx          *sync.Mutex
+	videoPublisher    *videoPublisher
+	videoEnabled      atomic.Bool
+	trackReaders      *sync.WaitGroup
 }
 
 type ConnectInfo struct {
-	Host     string
-	BuffSize int
+	Host          string
+	BuffSize      int
+	SendQueueSize int
+	RecvQueues    []RecvQueueConfig
+	RecvBudget    int
+	Allocator     pool.IAllocator
+	// Loopback impairs the link of a room connected to a loopback host.
+	Loopback loopback.Impairment
+	// CompressDict is the zstd dictionary shared by the peers of the room.
+	CompressDict    []byte
+	CompressMinSize int
 	lksdk.ConnectInfo
 }
 
-func ConnectToSecureRoom(connInfo *ConnectInfo) (ISecureRoom, error) {
-	var (
-		mtx           = &sync.RWMutex{}
-		closed        = make(chan struct{})
-		cipherManager = crypto.NewCipherManager()
-		dataPackCh    = make(chan *DataPacket, 2048)
-	)
-
-	buffSize := connInfo.BuffSize
-	roomCallback := &lksdk.RoomCallback{
-		ParticipantCallback: lksdk.ParticipantCallback{
-			OnDataPacket: onDataPacketCallback(mtx, closed, buffSize, cipherManager, dataPackCh),
-		},
+// newSecureRoom returns a room which is not connected yet.
+func newSecureRoom(connInfo *ConnectInfo) *secureRoom {
+	allocator := connInfo.Allocator
+	if allocator == nil {
+		allocator = pool.NewHeapAllocator()
 	}
 
-	lksdkRoom, err := lksdk.ConnectToRoom(connInfo.Host, connInfo.ConnectInfo, roomCallback)
-	if err != nil {
-		return nil, err
+	stats := &roomStats{}
+	recvQueue := newRecvQueue(connInfo.RecvQueues, connInfo.RecvBudget, stats)
+
+	// queued messages, messages held by readers and partial reassembly
+	buffPool := pool.NewBufferPool(allocator, 2*recvQueue.budget+reassemblyMaxBytes)
+	stateMtx := &sync.Mutex{}
+	room := &secureRoom{
+		mtx:           &sync.RWMutex{},
+		buffSize:      connInfo.BuffSize,
+		closed:        make(chan struct{}),
+		recvQueue:     recvQueue,
+		buffPool:      buffPool,
+		reassembler:   newReassembler(buffPool, connInfo.BuffSize, stats),
+		deliverer:     newDeliverer(),
+		cipherManager: crypto.NewCipherManager(),
+		compression:   newCompression(connInfo.CompressDict, connInfo.CompressMinSize, connInfo.BuffSize),
+		shardSalt:     lastShardSalt.Add(0x9e3779b97f4a7c15),
+		stats:         stats,
+		opening:       &sync.WaitGroup{},
+		readMtx:       &sync.Mutex{},
+		notifyMtx:     &sync.Mutex{},
+		audioMtx:      &sync.Mutex{},
+		playoutMtx:    &sync.RWMutex{},
+		playouts:      make(map[string]*jitterBuffer),
+		videoMtx:      &sync.Mutex{},
+		trackReaders:  &sync.WaitGroup{},
+		sendPool:      pool.NewBufferPool(pool.NewHeapAllocator(), sendPoolSize),
+		sendQueue:     newSendQueue(connInfo.SendQueueSize),
+		sendWorker:    make(chan struct{}),
+		connInfo:      connInfo,
+		stateMtx:      stateMtx,
+		stateCond:     sync.NewCond(stateMtx),
+		closing:       make(chan struct{}),
+		connector:     &sync.WaitGroup{},
 	}
 
-	return &secureRoom{
-		mtx:           mtx,
-		closed:        closed,
-		buffSize:      buffSize,
-		lksdkRoom:     lksdkRoom,
-		dataPackCh:    dataPackCh,
-		cipherManager: cipherManager,
-	}, nil
+	go room.runSendWorker()
+	return room
 }
 
 func (p *secureRoom) GetCipherManager() crypto.ICipherManager {
@@ -64,31 +164,202 @@ func (p *secureRoom) GetCipherManager() crypto.ICipherManager {
 }
 
 func (p *secureRoom) Close() {
-	for {
-		if ok := p.mtx.TryLock(); ok {
-			defer p.mtx.Unlock()
-			break
-		}
-		select {
-		case <-p.dataPackCh:
-		default:
-		}
-	}
+	p.beginClose()
+	p.sendQueue.close()
+	<-p.sendWorker
+	p.sendPool.Close()
+
+	// a connection being made is finished before it is torn down
+	p.connector.Wait()
+
+	// deliveries never block under the lock, so it is free soon
+	p.mtx.Lock()
 	close(p.closed)
-	close(p.dataPackCh)
-	p.lksdkRoom.Disconnect()
+	p.recvQueue.close()
+	p.deliverer.stop()
+	if t := p.transport.Swap(nil); t != nil {
+		(*t).Disconnect()
+	}
+	p.mtx.Unlock()
+
+	// a slow handler is waited for outside of the lock, so that the decrypt
+	// workers shared with other rooms don't wait for it in deliver
+	p.deliverer.wait()
+
+	// frames opened after the room closed deliver nothing, but they may
+	// still hold buffers of the pool or partial messages
+	p.trackReaders.Wait()
+	p.opening.Wait()
+
+	p.audioMtx.Lock()
+	if p.audioPublisher != nil {
+		p.audioPublisher.close()
+		p.audioPublisher = nil
+	}
+	p.audioMtx.Unlock()
+
+	p.readMtx.Lock()
+	if p.pending != nil {
+		p.pending.Release()
+		p.pending = nil
+	}
+	p.readMtx.Unlock()
+
+	// readers and connectors which loaded the notifier before the swap
+	// find it closed and leave the descriptor alone
+	p.notifyMtx.Lock()
+	if n := p.notifier.Swap(nil); n != nil {
+		(*n).Close()
+	}
+	p.notifyMtx.Unlock()
+
+	p.reassembler.close()
+	p.buffPool.Close()
 }
 
-func (p *secureRoom) ReceiveDataPacket(ctx context.Context) (*DataPacket, error) {
+// GetReadyFD returns a descriptor which is readable while the room has
+// received data. It stays owned by the room and is closed with it.
+func (p *secureRoom) GetReadyFD() (int, error) {
+	p.notifyMtx.Lock()
+	defer p.notifyMtx.Unlock()
+
+	if n := p.notifier.Load(); n != nil {
+		return (*n).FD(), nil
+	}
+
 	select {
-	case <-ctx.Done():
-		return nil, ctx.Err()
-	case dp, ok := <-p.dataPackCh:
-		if !ok {
-			return nil, ErrClosedChannel
+	case <-p.closed:
+		return 0, ErrClosedChannel
+	default:
+	}
+
+	n, err := notify.NewNotifier()
+	if err != nil {
+		return 0, err
+	}
+	p.notifier.Store(&n)
+	p.updateReadiness()
+
+	return n.FD(), nil
+}
+
+// ReceiveDataPacket returns the next message whole. The rest of a message
+// partly returned in chunks by ReceiveDataPackets comes first.
+func (p *secureRoom) ReceiveDataPacket(ctx context.Context) (*DataPacket, error) {
+	p.readMtx.Lock()
+	defer p.readMtx.Unlock()
+	defer func() {
+		p.hasPending.Store(p.pending != nil)
+		p.readDone()
+	}()
+
+	if p.pending != nil {
+		return p.nextChunk(0), nil
+	}
+	return p.recvQueue.pop(ctx)
+}
+
+// SetDataHandler makes the room push packets of the type to the handler
+// instead of queueing them for reads. A nil handler restores queueing.
+// Handlers run on a dedicated thread of the room and must not close it.
+func (p *secureRoom) SetDataHandler(dataType DataType, handler DataHandler) {
+	p.deliverer.setHandler(dataType, handler)
+}
+
+// GetStats returns a snapshot of the counters of the room.
+func (p *secureRoom) GetStats() Stats {
+	var stats Stats
+	p.stats.load(&stats)
+	p.recvQueue.load(&stats)
+	return stats
+}
+
+func (p *secureRoom) isReadable() bool {
+	return p.recvQueue.len() != 0 || p.hasPending.Load() || p.stateChanged.Load()
+}
+
+// readDone acknowledges a change of the connection state together with
+// the read and syncs the readiness descriptor.
+func (p *secureRoom) readDone() {
+	p.stateChanged.Store(false)
+	p.updateReadiness()
+}
+
+// updateReadiness syncs the readiness descriptor with the receive queue
+// after packets were taken from it.
+func (p *secureRoom) updateReadiness() {
+	n := p.notifier.Load()
+	if n == nil {
+		return
+	}
+	if p.isReadable() {
+		(*n).Set()
+		return
+	}
+	(*n).Clear()
+	if p.isReadable() {
+		(*n).Set()
+	}
+}
+
+// ReceiveDataPackets waits for the first packet and then drains up to
+// len(dataPacks) already queued packets without blocking again. If
+// chunkSize is positive, messages larger than chunkSize are returned as
+// several consecutive packets of at most chunkSize bytes.
+func (p *secureRoom) ReceiveDataPackets(ctx context.Context, dataPacks []*DataPacket, chunkSize int) (int, error) {
+	if len(dataPacks) == 0 {
+		return 0, nil
+	}
+
+	p.readMtx.Lock()
+	defer p.readMtx.Unlock()
+	defer func() {
+		p.hasPending.Store(p.pending != nil)
+		p.readDone()
+	}()
+
+	n := p.drainDataPackets(dataPacks, chunkSize)
+	if n != 0 {
+		return n, nil
+	}
+
+	dp, err := p.recvQueue.pop(ctx)
+	if err != nil {
+		return 0, err
+	}
+	p.pending, p.pendingOff = dp, 0
+
+	return p.drainDataPackets(dataPacks, chunkSize), nil
+}
+
+func (p *secureRoom) drainDataPackets(dataPacks []*DataPacket, chunkSize int) int {
+	for i := range dataPacks {
+		if p.pending == nil {
+			dp, ok, _ := p.recvQueue.tryPop()
+			if !ok {
+				return i
+			}
+			p.pending, p.pendingOff = dp, 0
 		}
-		return dp, nil
+		dataPacks[i] = p.nextChunk(chunkSize)
 	}
+	return len(dataPacks)
+}
+
+func (p *secureRoom) nextChunk(chunkSize int) *DataPacket {
+	dp := p.pending
+	if chunkSize <= 0 || len(dp.Payload)-p.pendingOff <= chunkSize {
+		if p.pendingOff != 0 {
+			dp.Payload = dp.Payload[p.pendingOff:]
+		}
+		p.pending = nil
+		return dp
+	}
+
+	end := p.pendingOff + chunkSize
+	chunk := newChunkDataPacket(dp, p.pendingOff, end)
+	p.pendingOff = end
+	return chunk
 }
 
 func (p *secureRoom) PublishDataPacket(_ context.Context, dataPack *DataPacket) error {
@@ -96,73 +367,497 @@ func (p *secureRoom) PublishDataPacket(_ context.Context, dataPack *DataPacket)
 		return ErrBuffSize
 	}
 
-	cipher, ok := p.cipherManager.GetTX()
+	keyID, cipher, ok := p.cipherManager.GetTX()
 	if !ok {
 		return ErrGetTXCipher
 	}
 
-	encData, err := cipher.Encrypt(dataPack.Payload)
+	sealed := sealedPool.Get().(*sealedMessage)
+	defer sealedPool.Put(sealed)
+
+	compressor := p.compression.forPayload(dataPack.Type, len(dataPack.Payload))
+	if err := sealed.seal(keyID, cipher, compressor, dataPack, &p.stats.encryptLatency); err != nil {
+		return err
+	}
+	return p.publishSealed(sealed, dataPack.Destinations)
+}
+
+// PublishDataVector publishes the buffers of the payload as one message
+// without joining them first. The buffers are only read during the call.
+func (p *secureRoom) PublishDataVector(_ context.Context, dataType DataType, payload [][]byte) error {
+	size := vectorSize(payload)
+	if size > p.buffSize {
+		return ErrBuffSize
+	}
+
+	keyID, cipher, ok := p.cipherManager.GetTX()
+	if !ok {
+		return ErrGetTXCipher
+	}
+
+	sealed := sealedPool.Get().(*sealedMessage)
+	defer sealedPool.Put(sealed)
+
+	compressor := p.compression.forPayload(dataType, size)
+	if err := sealed.sealVector(keyID, cipher, compressor, dataType, 0, payload, &p.stats.encryptLatency); err != nil {
+		return err
+	}
+	return p.publishSealed(sealed, nil)
+}
+
+// publishSealed publishes the frames of a message sealed with the tx key
+// of the room.
+func (p *secureRoom) publishSealed(sealed *sealedMessage, destinations []string) error {
+	transport := p.getTransport()
+	if transport == nil {
+		return ErrNotConnected
+	}
+
+	isReliable := (sealed.dataType == TextDataType) || (sealed.dataType == SignalDataType)
+	for _, frame := range sealed.frames {
+		if err := transport.PublishData(frame, isReliable, destinations); err != nil {
+			return err
+		}
+	}
+
+	p.stats.sent(sealed.dataType, sealed.size)
+	return nil
+}
+
+// EnqueueDataPacket copies the message into the send queue of the room and
+// returns without waiting for it to be published. When the queue is full
+// the send policy of the message type applies.
+func (p *secureRoom) EnqueueDataPacket(ctx context.Context, dataPack *DataPacket) error {
+	dp, err := p.copyToSendPool(dataPack)
 	if err != nil {
+		if err == ErrQueueFull {
+			p.sendQueue.addDropped(1)
+		}
 		return err
 	}
+	return p.sendQueue.push(ctx, dp)
+}
 
-	isReliable := (dataPack.Type == TextDataType) || (dataPack.Type == SignalDataType)
-	return p.lksdkRoom.LocalParticipant.PublishDataPacket(
-		lksdk.UserData(encData),
-		lksdk.WithDataPublishTopic(fmt.Sprintf("%d", dataPack.Type)),
-		lksdk.WithDataPublishReliable(isReliable),
-	)
+// TryEnqueueDataPacket is EnqueueDataPacket which never waits. A full
+// queue under the block policy returns ErrQueueFull.
+func (p *secureRoom) TryEnqueueDataPacket(dataPack *DataPacket) error {
+	dp, err := p.copyToSendPool(dataPack)
+	if err != nil {
+		if err == ErrQueueFull {
+			p.sendQueue.addDropped(1)
+		}
+		return err
+	}
+	return p.sendQueue.tryPush(dp)
 }
 
-func onDataPacketCallback(
-	roomMtx *sync.RWMutex,
-	closed chan struct{},
-	buffSize int,
-	cipherManager crypto.ICipherManager,
-	dataPackCh chan *DataPacket,
-) func(data lksdk.DataPacket, params lksdk.DataReceiveParams) {
-	return func(data lksdk.DataPacket, params lksdk.DataReceiveParams) {
-		dp, ok := data.(*lksdk.UserDataPacket)
-		if !ok {
-			return
+// TryEnqueueDataPackets is TryEnqueueDataPacket for the consecutive
+// messages of one write of the same type, which are queued all or none.
+func (p *secureRoom) TryEnqueueDataPackets(dataPacks []*DataPacket) error {
+	dps := make([]*DataPacket, 0, len(dataPacks))
+	for _, dataPack := range dataPacks {
+		dp, err := p.copyToSendPool(dataPack)
+		if err != nil {
+			for _, dp := range dps {
+				dp.Release()
+			}
+			if err == ErrQueueFull {
+				p.sendQueue.addDropped(len(dataPacks))
+			}
+			return err
 		}
+		dps = append(dps, dp)
+	}
+	return p.sendQueue.tryPushAll(dps)
+}
+
+func (p *secureRoom) copyToSendPool(dataPack *DataPacket) (*DataPacket, error) {
+	if len(dataPack.Payload) > p.buffSize {
+		return nil, ErrBuffSize
+	}
+
+	buffer, ok := p.sendPool.Get(len(dataPack.Payload))
+	if !ok {
+		return nil, ErrQueueFull
+	}
+	copy(buffer.Bytes(), dataPack.Payload)
+
+	dp := newPooledDataPacket(dataPack.Type, "", buffer.Bytes(), buffer)
+	if len(dataPack.Destinations) != 0 {
+		dp.Destinations = slices.Clone(dataPack.Destinations)
+	}
+	return dp, nil
+}
+
+func (p *secureRoom) SetSendPolicy(dataType DataType, policy QueuePolicy) {
+	p.sendQueue.setPolicy(dataType, policy)
+}
 
-		ident := params.SenderIdentity
-		cipher, ok := cipherManager.GetRX(ident)
+func (p *secureRoom) GetSendQueueState() SendQueueState {
+	return p.sendQueue.state()
+}
+
+func (p *secureRoom) runSendWorker() {
+	defer close(p.sendWorker)
+
+	ctx := context.Background()
+	for {
+		dp, ok := p.sendQueue.pop()
 		if !ok {
 			return
 		}
+		// queued messages wait for the room to connect
+		if !p.waitConnected() {
+			p.sendQueue.addFailed()
+			dp.Release()
+			continue
+		}
+		if err := p.PublishDataPacket(ctx, dp); err != nil {
+			p.sendQueue.addFailed()
+		}
+		dp.Release()
+	}
+}
+
+// sealFrame builds the packet key id || data type || nonce ||
+// sealed(header || fragment) in buf, where the fragment is size bytes of
+// the payload from offset on. The data type is repeated in clear, so that
+// receivers can skip unsubscribed frames without decrypting them. The frame
+// is sealed in place, so the fragment is copied once.
+func sealFrame(buf []byte, keyID uint8, cipher crypto.ICipher, header *frameHeader, payload [][]byte, offset, size int) ([]byte, error) {
+	var (
+		sealOff   = keyIDSize + dataTypeSize
+		plainOff  = sealOff + cipher.NonceSize()
+		plainSize = frameHeaderSize + size
+		bufSize   = sealOff + plainSize + cipher.Overhead()
+	)
+	if cap(buf) < bufSize {
+		buf = make([]byte, 0, bufSize)
+	}
+	buf = buf[:plainOff+plainSize]
+
+	buf[0] = keyID
+	buf[1] = byte(header.dataType)
+	header.encode(buf[plainOff:])
+	copyVector(buf[plainOff+frameHeaderSize:], payload, offset)
+
+	sealed, err := cipher.EncryptTo(buf[sealOff:sealOff], buf[plainOff:])
+	if err != nil {
+		return nil, err
+	}
+	return buf[:sealOff+len(sealed)], nil
+}
+
+// sealedMessage holds the sealed frames of one message in one buffer.
+// The frames can be published to every room with the same tx key and
+// compressor.
+type sealedMessage struct {
+	dataType DataType
+	size     int
+	frames   [][]byte
+
+	buf        []byte
+	compressed []byte
+	flat       []byte
+	single     [1][]byte
+}
+
+func (p *sealedMessage) seal(keyID uint8, cipher crypto.ICipher, compressor compress.ICompressor, dataPack *DataPacket, latency *latencyHistogram) error {
+	p.single[0] = dataPack.Payload
+	defer func() { p.single[0] = nil }()
+
+	return p.sealVector(keyID, cipher, compressor, dataPack.Type, dataPack.flags, p.single[:], latency)
+}
+
+// sealVector seals the payload scattered over several buffers as one
+// message with the frame flags. The payload is read while sealing only and
+// is compressed first with the compressor, if there is one and the payload
+// gets smaller. The encryption of each fragment is timed into latency.
+func (p *sealedMessage) sealVector(keyID uint8, cipher crypto.ICipher, compressor compress.ICompressor, dataType DataType, flags uint8, payload [][]byte, latency *latencyHistogram) error {
+	if len(payload) == 0 {
+		p.single[0] = nil
+		payload = p.single[:]
+	}
+
+	size := vectorSize(payload)
+	p.dataType, p.size = dataType, size
 
-		decPld, err := cipher.Decrypt(dp.Payload)
+	if compressor != nil {
+		src := payload[0]
+		if len(payload) != 1 {
+			p.flat = appendVector(p.flat[:0], payload)
+			src = p.flat
+		}
+		p.compressed = compressor.Compress(p.compressed, src)
+		if len(p.compressed) < size {
+			p.single[0] = p.compressed
+			payload, size, flags = p.single[:], len(p.compressed), flags|uint8(compressor.Codec())
+		}
+	}
+
+	var (
+		fragCount = fragmentCount(size)
+		frameSize = keyIDSize + dataTypeSize + frameHeaderSize + fragmentSize + cipher.Overhead()
+		header    = frameHeader{
+			dataType:  dataType,
+			flags:     flags,
+			messageID: nextMessageID(),
+			fragCount: uint16(fragCount),
+		}
+	)
+	if cap(p.buf) < fragCount*frameSize {
+		p.buf = make([]byte, fragCount*frameSize)
+	}
+	p.frames = slices.Grow(p.frames[:0], fragCount)[:fragCount]
+
+	workers := 1
+	if threshold := sealThreshold(); threshold > 0 && size >= threshold {
+		workers = min(runtime.GOMAXPROCS(0), fragCount/sealWorkerFragments)
+	}
+	if workers <= 1 {
+		return p.sealFragments(keyID, cipher, header, payload, size, frameSize, 0, fragCount, latency)
+	}
+
+	// the fragments are sealed in parallel and stay in order in frames
+	var (
+		wg   = &sync.WaitGroup{}
+		errs = make([]error, workers)
+		per  = (fragCount + workers - 1) / workers
+	)
+	for w := 1; w < workers; w++ {
+		wg.Add(1)
+		go func(w int) {
+			defer wg.Done()
+			errs[w] = p.sealFragments(keyID, cipher, header, payload, size, frameSize, w*per, min((w+1)*per, fragCount), latency)
+		}(w)
+	}
+	errs[0] = p.sealFragments(keyID, cipher, header, payload, size, frameSize, 0, per, latency)
+	wg.Wait()
+
+	for _, err := range errs {
 		if err != nil {
-			return
+			return err
 		}
+	}
+	return nil
+}
 
-		pldSize := len(decPld)
-		if pldSize > buffSize {
-			return
+func (p *sealedMessage) sealFragments(keyID uint8, cipher crypto.ICipher, header frameHeader, payload [][]byte, size, frameSize, from, to int, latency *latencyHistogram) error {
+	for i := from; i < to; i++ {
+		var (
+			offset   = i * fragmentSize
+			fragSize = min(fragmentSize, size-offset)
+		)
+
+		header.fragIndex = uint16(i)
+		start := time.Now()
+		frame, err := sealFrame(p.buf[i*frameSize:i*frameSize:(i+1)*frameSize], keyID, cipher, &header, payload, offset, fragSize)
+		if err != nil {
+			return err
 		}
+		latency.observe(start)
+		p.frames[i] = frame
+	}
+	return nil
+}
+
+// SetSealParallelThreshold sets the size from which messages are sealed on
+// several cores. Zero restores the default of 32 KiB and a negative size
+// turns parallel sealing off.
+func SetSealParallelThreshold(n int) {
+	sealParallelThreshold.Store(int64(n))
+}
+
+func sealThreshold() int {
+	threshold := int(sealParallelThreshold.Load())
+	if threshold == 0 {
+		return defaultSealParallelThreshold
+	}
+	return threshold
+}
+
+// sealSample builds the packet key id || nonce || sealed(sample) in buf for
+// the payload of a media track sample.
+func sealSample(buf []byte, keyID uint8, cipher crypto.ICipher, sample []byte) ([]byte, error) {
+	size := keyIDSize + len(sample) + cipher.Overhead()
+	if cap(buf) < size {
+		buf = make([]byte, 0, size)
+	}
+	buf = buf[:keyIDSize]
+
+	buf[0] = keyID
+	sealed, err := cipher.EncryptTo(buf[keyIDSize:keyIDSize], sample)
+	if err != nil {
+		return nil, err
+	}
+	return buf[:keyIDSize+len(sealed)], nil
+}
+
+// onTrackSubscribed starts a reader for each remote media track which the
+// room can decode. Readers end when the connection of the room is closed.
+func (p *secureRoom) onTrackSubscribed(track *webrtc.TrackRemote, _ *lksdk.RemoteTrackPublication, rp *lksdk.RemoteParticipant) {
+	p.mtx.RLock()
+	defer p.mtx.RUnlock()
+
+	select {
+	case <-p.closed:
+		return
+	default:
+	}
+
+	switch mimeType := track.Codec().MimeType; {
+	case strings.EqualFold(mimeType, webrtc.MimeTypeOpus):
+		p.trackReaders.Add(1)
+		go p.readAudioTrack(track, rp.Identity())
+	case strings.EqualFold(mimeType, webrtc.MimeTypeH264):
+		p.trackReaders.Add(1)
+		go p.readVideoTrack(track, rp)
+	}
+}
 
-		dataType, err := strconv.Atoi(dp.Topic)
-		if err != nil || dataType >= int(endDataType) {
+func (p *secureRoom) onDataPacket(data lksdk.DataPacket, params lksdk.DataReceiveParams) {
+	dp, ok := data.(*lksdk.UserDataPacket)
+	if !ok {
+		p.stats.drop(NotUserDataDropReason)
+		return
+	}
+	p.onData(dp.Payload, params.SenderIdentity)
+}
+
+// openData opens a sealed frame of the sender and delivers the message
+// once it is complete.
+func (p *secureRoom) openData(payload []byte, ident string) {
+	if len(payload) < keyIDSize+dataTypeSize {
+		p.stats.drop(BadFrameDropReason)
+		return
+	}
+	dataType := DataType(payload[keyIDSize])
+	if !p.accepts(dataType, ident) {
+		return
+	}
+
+	buffer, frame, ok := p.openSealed(ident, payload[0], payload[keyIDSize+dataTypeSize:])
+	if !ok {
+		return
+	}
+
+	// the clear data type is authenticated by the sealed one
+	header, ok := decodeFrameHeader(frame)
+	if !ok || header.dataType != dataType {
+		p.stats.drop(BadFrameDropReason)
+		buffer.Release()
+		return
+	}
+	fragment := frame[frameHeaderSize:]
+
+	if header.fragCount == 1 {
+		if len(fragment) > p.buffSize {
+			p.stats.drop(OversizeDropReason)
+			buffer.Release()
 			return
 		}
+		buffer.SetSize(len(frame))
+		p.deliverMessage(newPooledDataPacket(header.dataType, ident, fragment, buffer), header.flags)
+		return
+	}
 
-		roomMtx.Lock()
-		defer roomMtx.Unlock()
+	msgBuffer, msgHeader, ok := p.reassembler.add(ident, header, fragment)
+	buffer.Release()
+	if !ok {
+		return
+	}
+	p.deliverMessage(newPooledDataPacket(msgHeader.dataType, ident, msgBuffer.Bytes(), msgBuffer), msgHeader.flags)
+}
 
-		select {
-		case <-closed:
-			return
-		default:
-		}
-		select {
-		case dataPackCh <- &DataPacket{
-			Type:    DataType(dataType),
-			Ident:   ident,
-			Payload: decPld,
-		}:
-		default:
+// deliverMessage delivers a received data message after it is
+// decompressed and the audio ones are adapted to the subscription.
+func (p *secureRoom) deliverMessage(pack *DataPacket, flags uint8) {
+	pack, ok := p.decompressPacket(pack, flags)
+	if !ok {
+		return
+	}
+	if pack, ok := p.adaptAudioPacket(pack, flags); ok {
+		p.deliver(pack)
+	}
+}
+
+// openPacket decrypts the packet key id || nonce || sealed(plaintext) of
+// the sender into a pool buffer. The caller releases the buffer.
+func (p *secureRoom) openPacket(ident string, packet []byte) (*pool.Buffer, []byte, bool) {
+	if len(packet) < keyIDSize {
+		p.stats.drop(BadFrameDropReason)
+		return nil, nil, false
+	}
+	return p.openSealed(ident, packet[0], packet[keyIDSize:])
+}
+
+// openSealed decrypts nonce || sealed(plaintext) under the key id of the
+// sender into a pool buffer. The caller releases the buffer.
+func (p *secureRoom) openSealed(ident string, keyID uint8, sealed []byte) (*pool.Buffer, []byte, bool) {
+	buffer, ok := p.buffPool.Get(len(sealed))
+	if !ok {
+		p.stats.drop(NoBufferDropReason)
+		return nil, nil, false
+	}
+
+	plaintext, ok := p.openSealedTo(buffer.Cap(), ident, keyID, sealed)
+	if !ok {
+		buffer.Release()
+		return nil, nil, false
+	}
+	return buffer, plaintext, true
+}
+
+// openPacketTo decrypts the packet into the memory of dst like DecryptTo.
+func (p *secureRoom) openPacketTo(dst []byte, ident string, packet []byte) ([]byte, bool) {
+	if len(packet) < keyIDSize {
+		p.stats.drop(BadFrameDropReason)
+		return nil, false
+	}
+	return p.openSealedTo(dst, ident, packet[0], packet[keyIDSize:])
+}
+
+func (p *secureRoom) openSealedTo(dst []byte, ident string, keyID uint8, sealed []byte) ([]byte, bool) {
+	cipher, ok := p.cipherManager.GetRX(ident, keyID)
+	if !ok {
+		p.stats.drop(UnknownKeyDropReason)
+		return nil, false
+	}
+
+	start := time.Now()
+	plaintext, err := cipher.DecryptTo(dst, sealed)
+	if err != nil {
+		p.stats.drop(DecryptDropReason)
+		return nil, false
+	}
+	p.stats.decryptLatency.observe(start)
+
+	return plaintext, true
+}
+
+// deliver may run on several decrypt workers at once, the queue and the
+// deliverer are safe for concurrent use.
+func (p *secureRoom) deliver(pack *DataPacket) {
+	p.mtx.RLock()
+	defer p.mtx.RUnlock()
+
+	select {
+	case <-p.closed:
+		p.stats.drop(ClosedDropReason)
+		pack.Release()
+		return
+	default:
+	}
+	p.stats.received(pack)
+	if p.deliverer.hasHandler(pack.Type) {
+		if !p.deliverer.push(pack) {
+			p.stats.drop(HandlerBusyDropReason)
+		}
+		return
+	}
+	if p.recvQueue.push(pack) {
+		if n := p.notifier.Load(); n != nil {
+			(*n).Set()
 		}
 	}
 }
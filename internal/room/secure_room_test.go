@@ -0,0 +1,287 @@
+package room
+
+import (
+	"bytes"
+	"context"
+	"math/rand"
+	"runtime"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"github.com/number571/clivekit/internal/crypto"
+	"github.com/number571/clivekit/internal/pool"
+)
+
+func TestReceiveAfterChunkedRead(t *testing.T) {
+	ctx := context.Background()
+	room := newSecureRoom(&ConnectInfo{BuffSize: 1 << 16})
+	defer room.Close()
+
+	first, second := bytes.Repeat([]byte{1}, 100), []byte{2}
+	room.deliver(&DataPacket{Type: TextDataType, Payload: first})
+	room.deliver(&DataPacket{Type: TextDataType, Payload: second})
+
+	chunks := make([]*DataPacket, 1)
+	if n, err := room.ReceiveDataPackets(ctx, chunks, 40); err != nil || n != 1 {
+		t.Fatal(n, err)
+	}
+	if !bytes.Equal(chunks[0].Payload, first[:40]) {
+		t.Fatal("first chunk")
+	}
+	chunks[0].Release()
+
+	// the rest of the chunked message comes before the next one
+	for _, want := range [][]byte{first[40:], second} {
+		dp, err := room.ReceiveDataPacket(ctx)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if !bytes.Equal(dp.Payload, want) {
+			t.Fatalf("got %d bytes, want %d", len(dp.Payload), len(want))
+		}
+		dp.Release()
+	}
+}
+
+// newKeyedRoom returns a room which seals with a zero key and opens the
+// frames of the senders with the same key, along with its tx key.
+func newKeyedRoom(tb testing.TB, connInfo *ConnectInfo, idents ...string) (*secureRoom, uint8, crypto.ICipher) {
+	tb.Helper()
+
+	key := make([]byte, 32)
+	room := newSecureRoom(connInfo)
+	room.cipherManager.SetTX(crypto.NewCipher(key))
+	for _, ident := range idents {
+		room.cipherManager.AddRX(ident, crypto.NewCipher(key))
+	}
+	keyID, cipher, ok := room.cipherManager.GetTX()
+	if !ok {
+		tb.Fatal("no tx key")
+	}
+	return room, keyID, cipher
+}
+
+func TestCloseUnderTraffic(t *testing.T) {
+	const ident = "peer"
+
+	allocator := &countingAllocator{}
+	room, keyID, cipher := newKeyedRoom(t, &ConnectInfo{BuffSize: 1 << 16, Allocator: allocator}, ident)
+
+	// messages of several fragments, so that partial ones are reassembled
+	// while the room closes
+	sealed := &sealedMessage{}
+	if err := sealed.seal(keyID, cipher, nil, &DataPacket{Type: TextDataType, Payload: make([]byte, 8<<10)}, &room.stats.encryptLatency); err != nil {
+		t.Fatal(err)
+	}
+	frames := make([][]byte, len(sealed.frames))
+	for i, frame := range sealed.frames {
+		frames[i] = bytes.Clone(frame)
+	}
+
+	var (
+		wg   sync.WaitGroup
+		stop atomic.Bool
+	)
+	for i := 0; i < 4; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for !stop.Load() {
+				for _, frame := range frames {
+					room.onData(frame, ident)
+				}
+			}
+		}()
+	}
+	for room.stats.packetsIn[TextDataType].Load() == 0 {
+		runtime.Gosched()
+	}
+	room.Close()
+	stop.Store(true)
+	wg.Wait()
+
+	if allocs, frees := allocator.allocs.Load(), allocator.frees.Load(); allocs != frees {
+		t.Fatalf("%d buffers allocated, %d freed", allocs, frees)
+	}
+}
+
+func TestCloseWithBusyHandler(t *testing.T) {
+	busy := newSecureRoom(&ConnectInfo{BuffSize: 1 << 16})
+	other := newSecureRoom(&ConnectInfo{BuffSize: 1 << 16})
+	defer other.Close()
+
+	entered, release := make(chan struct{}), make(chan struct{})
+	busy.SetDataHandler(TextDataType, func(*DataPacket) {
+		close(entered)
+		<-release
+	})
+	busy.deliver(&DataPacket{Type: TextDataType})
+	<-entered
+
+	closed := make(chan struct{})
+	go func() {
+		busy.Close()
+		close(closed)
+	}()
+	for !busy.deliverer.stopping.Load() {
+		runtime.Gosched()
+	}
+
+	// the rooms share a decrypt worker, which delivers to both in turn
+	delivered := make(chan struct{})
+	go func() {
+		busy.deliver(&DataPacket{Type: TextDataType})
+		other.deliver(&DataPacket{Type: TextDataType})
+		close(delivered)
+	}()
+	select {
+	case <-delivered:
+	case <-time.After(time.Second):
+		t.Fatal("delivery waits for the handler of a closing room")
+	}
+	if _, ok, _ := other.recvQueue.tryPop(); !ok {
+		t.Fatal("other room received nothing")
+	}
+
+	close(release)
+	<-closed
+}
+
+type countingAllocator struct {
+	allocs atomic.Int64
+	frees  atomic.Int64
+}
+
+func (p *countingAllocator) Alloc(n int) []byte {
+	p.allocs.Add(1)
+	return make([]byte, n)
+}
+
+func (p *countingAllocator) Free([]byte) {
+	p.frees.Add(1)
+}
+
+func TestParallelSeal(t *testing.T) {
+	const ident = "peer"
+
+	defer runtime.GOMAXPROCS(runtime.GOMAXPROCS(4))
+	defer SetSealParallelThreshold(0)
+
+	room, keyID, cipher := newKeyedRoom(t, &ConnectInfo{BuffSize: 1 << 20}, ident)
+	defer room.Close()
+
+	// pieces which end inside fragments, so workers read across them
+	payload := make([]byte, 64<<10)
+	rand.New(rand.NewSource(1)).Read(payload)
+	vector := [][]byte{payload[:1000], payload[1000:40000], payload[40000:]}
+
+	open := func(threshold int) []byte {
+		SetSealParallelThreshold(threshold)
+		sealed := &sealedMessage{}
+		if err := sealed.sealVector(keyID, cipher, nil, TextDataType, 0, vector, &room.stats.encryptLatency); err != nil {
+			t.Fatal(err)
+		}
+		if len(sealed.frames) != fragmentCount(len(payload)) {
+			t.Fatalf("%d frames", len(sealed.frames))
+		}
+		for _, frame := range sealed.frames {
+			room.openData(frame, ident)
+		}
+		dp, ok, _ := room.recvQueue.tryPop()
+		if !ok {
+			t.Fatalf("threshold %d: message not opened", threshold)
+		}
+		defer dp.Release()
+		return bytes.Clone(dp.Payload)
+	}
+
+	serial, parallel := open(-1), open(1)
+	if !bytes.Equal(serial, payload) || !bytes.Equal(parallel, serial) {
+		t.Fatal("parallel seal differs from the serial one")
+	}
+}
+
+// BenchmarkReceiveVideo opens the frames of 16 KiB messages, about 380 per
+// second of a 50 Mbit/s stream, and reads them. The pooled path decrypts
+// into the buffers of the room, the heap one allocates like a plain
+// Decrypt and append.
+func BenchmarkReceiveVideo(b *testing.B) {
+	const ident = "peer"
+
+	ctx := context.Background()
+	payload := make([]byte, 16<<10)
+
+	room, keyID, cipher := newKeyedRoom(b, &ConnectInfo{BuffSize: 1 << 20}, ident)
+	defer room.Close()
+
+	sealed := &sealedMessage{}
+	if err := sealed.seal(keyID, cipher, nil, &DataPacket{Type: VideoDataType, Payload: payload}, &room.stats.encryptLatency); err != nil {
+		b.Fatal(err)
+	}
+
+	b.Run("pooled", func(b *testing.B) {
+		reportGC(b, func() {
+			for _, frame := range sealed.frames {
+				room.openData(frame, ident)
+			}
+			dp, err := room.ReceiveDataPacket(ctx)
+			if err != nil {
+				b.Fatal(err)
+			}
+			dp.Release()
+		})
+	})
+	// the borrowed read of C lends the payload buffer and takes it back on
+	// release
+	b.Run("borrowed", func(b *testing.B) {
+		reportGC(b, func() {
+			for _, frame := range sealed.frames {
+				room.openData(frame, ident)
+			}
+			dp, err := room.ReceiveDataPacket(ctx)
+			if err != nil {
+				b.Fatal(err)
+			}
+			buffer, _ := dp.Detach()
+			h, _ := buffer.Lend()
+			if buffer, ok := pool.TakeLent(h); ok {
+				buffer.Release()
+			}
+		})
+	})
+	b.Run("heap", func(b *testing.B) {
+		sealedOff := keyIDSize + dataTypeSize
+		reportGC(b, func() {
+			var msg []byte
+			for _, frame := range sealed.frames {
+				plaintext, err := cipher.Decrypt(frame[sealedOff:])
+				if err != nil {
+					b.Fatal(err)
+				}
+				msg = append(msg, plaintext[frameHeaderSize:]...)
+			}
+			if len(msg) != len(payload) {
+				b.Fatal("size")
+			}
+		})
+	})
+}
+
+// reportGC runs op b.N times and reports the allocations and GC cycles.
+func reportGC(b *testing.B, op func()) {
+	var before, after runtime.MemStats
+	runtime.GC()
+	runtime.ReadMemStats(&before)
+
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		op()
+	}
+	b.StopTimer()
+
+	runtime.ReadMemStats(&after)
+	b.ReportMetric(float64(after.NumGC-before.NumGC)/float64(b.N), "gc/op")
+}
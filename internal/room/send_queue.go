@@ -0,0 +1,266 @@
+package room
+
+import (
+	"context"
+	"sync"
+)
+
+const (
+	defaultSendQueueSize = 256
+)
+
+type SendQueueState struct {
+	Length   int
+	Capacity int
+	Bytes    int
+	Dropped  uint64
+	Failed   uint64
+}
+
+// sendQueue is a bounded FIFO of messages drained by a single worker, which
+// seals and publishes them off the producer's thread.
+type sendQueue struct {
+	mtx      *sync.Mutex
+	notFull  *sync.Cond
+	notEmpty *sync.Cond
+	closed   bool
+	policies [endDataType]QueuePolicy
+	items    []*DataPacket
+	head     int
+	length   int
+	bytes    int
+	dropped  uint64
+	failed   uint64
+}
+
+func newSendQueue(size int) *sendQueue {
+	if size <= 0 {
+		size = defaultSendQueueSize
+	}
+	mtx := &sync.Mutex{}
+	q := &sendQueue{
+		mtx:      mtx,
+		notFull:  sync.NewCond(mtx),
+		notEmpty: sync.NewCond(mtx),
+		items:    make([]*DataPacket, size),
+	}
+	q.policies[AudioDataType] = DropOldestQueuePolicy
+	q.policies[VideoDataType] = DropNewestQueuePolicy
+	return q
+}
+
+func (p *sendQueue) setPolicy(dataType DataType, policy QueuePolicy) {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	p.policies[dataType] = policy
+}
+
+func (p *sendQueue) state() SendQueueState {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	return SendQueueState{
+		Length:   p.length,
+		Capacity: len(p.items),
+		Bytes:    p.bytes,
+		Dropped:  p.dropped,
+		Failed:   p.failed,
+	}
+}
+
+// push takes ownership of dp. On error dp is released. Under the block
+// policy it waits for free space until ctx is done.
+func (p *sendQueue) push(ctx context.Context, dp *DataPacket) error {
+	return p.enqueue(ctx, dp, true)
+}
+
+// tryPush is push which never waits: a full queue under the block policy
+// drops dp like the drop newest policy.
+func (p *sendQueue) tryPush(dp *DataPacket) error {
+	return p.enqueue(context.Background(), dp, false)
+}
+
+// tryPushAll is tryPush for several messages of one type, which are queued
+// all or none. It takes ownership of dps.
+func (p *sendQueue) tryPushAll(dps []*DataPacket) error {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	release := func() {
+		for _, dp := range dps {
+			dp.Release()
+		}
+	}
+	if len(dps) == 0 {
+		return nil
+	}
+	if p.closed {
+		release()
+		return ErrClosedChannel
+	}
+
+	// old messages are evicted only if that makes room for all new ones
+	dataType := dps[0].Type
+	free := len(p.items) - p.length
+	if free < len(dps) && p.policies[dataType] == DropOldestQueuePolicy {
+		free += p.count(dataType)
+	}
+	if free < len(dps) {
+		p.dropped += uint64(len(dps))
+		release()
+		return ErrQueueFull
+	}
+	for len(p.items)-p.length < len(dps) {
+		p.dropOldest(dataType)
+	}
+
+	for _, dp := range dps {
+		p.items[(p.head+p.length)%len(p.items)] = dp
+		p.length++
+		p.bytes += len(dp.Payload)
+	}
+	p.notEmpty.Signal()
+	return nil
+}
+
+func (p *sendQueue) enqueue(ctx context.Context, dp *DataPacket, block bool) error {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	for !p.closed && p.length == len(p.items) {
+		switch p.policies[dp.Type] {
+		case DropOldestQueuePolicy:
+			if p.dropOldest(dp.Type) {
+				continue
+			}
+			fallthrough
+		case DropNewestQueuePolicy:
+			p.dropped++
+			dp.Release()
+			return ErrQueueFull
+		}
+		if !block {
+			p.dropped++
+			dp.Release()
+			return ErrQueueFull
+		}
+		if err := p.wait(ctx); err != nil {
+			p.dropped++
+			dp.Release()
+			return err
+		}
+	}
+
+	if p.closed {
+		dp.Release()
+		return ErrClosedChannel
+	}
+
+	p.items[(p.head+p.length)%len(p.items)] = dp
+	p.length++
+	p.bytes += len(dp.Payload)
+	p.notEmpty.Signal()
+	return nil
+}
+
+// pop waits for the next message. It returns false once the queue was
+// closed.
+func (p *sendQueue) pop() (*DataPacket, bool) {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	for !p.closed && p.length == 0 {
+		p.notEmpty.Wait()
+	}
+	if p.closed {
+		return nil, false
+	}
+
+	dp := p.items[p.head]
+	p.items[p.head] = nil
+	p.head = (p.head + 1) % len(p.items)
+	p.length--
+	p.bytes -= len(dp.Payload)
+	p.notFull.Signal()
+	return dp, true
+}
+
+func (p *sendQueue) addFailed() {
+	p.mtx.Lock()
+	p.failed++
+	p.mtx.Unlock()
+}
+
+// addDropped counts messages dropped before they reached the queue, for
+// lack of send buffers.
+func (p *sendQueue) addDropped(n int) {
+	p.mtx.Lock()
+	p.dropped += uint64(n)
+	p.mtx.Unlock()
+}
+
+func (p *sendQueue) close() {
+	p.mtx.Lock()
+	defer p.mtx.Unlock()
+
+	p.closed = true
+	for ; p.length != 0; p.length-- {
+		p.items[p.head].Release()
+		p.items[p.head] = nil
+		p.head = (p.head + 1) % len(p.items)
+	}
+	p.bytes = 0
+	p.notFull.Broadcast()
+	p.notEmpty.Broadcast()
+}
+
+// wait blocks on notFull until it is signalled or ctx is done.
+func (p *sendQueue) wait(ctx context.Context) error {
+	if ctx.Done() == nil {
+		p.notFull.Wait()
+		return nil
+	}
+	if err := ctx.Err(); err != nil {
+		return err
+	}
+	stop := context.AfterFunc(ctx, func() {
+		p.mtx.Lock()
+		p.notFull.Broadcast()
+		p.mtx.Unlock()
+	})
+	defer stop()
+	p.notFull.Wait()
+	return ctx.Err()
+}
+
+func (p *sendQueue) count(dataType DataType) int {
+	n := 0
+	for i := 0; i < p.length; i++ {
+		if p.items[(p.head+i)%len(p.items)].Type == dataType {
+			n++
+		}
+	}
+	return n
+}
+
+func (p *sendQueue) dropOldest(dataType DataType) bool {
+	for i := 0; i < p.length; i++ {
+		k := (p.head + i) % len(p.items)
+		if p.items[k].Type != dataType {
+			continue
+		}
+		p.bytes -= len(p.items[k].Payload)
+		p.items[k].Release()
+		for ; i > 0; i-- {
+			prev := (p.head + i - 1) % len(p.items)
+			p.items[(p.head+i)%len(p.items)] = p.items[prev]
+		}
+		p.items[p.head] = nil
+		p.head = (p.head + 1) % len(p.items)
+		p.length--
+		p.dropped++
+		return true
+	}
+	return false
+}
@@ -0,0 +1,132 @@
+package room
+
+import (
+	"context"
+	"testing"
+	"time"
+)
+
+func TestSendQueuePolicies(t *testing.T) {
+	ctx := context.Background()
+	queue := newSendQueue(1)
+	defer queue.close()
+
+	if err := queue.push(ctx, &DataPacket{Type: AudioDataType}); err != nil {
+		t.Fatal(err)
+	}
+	// audio drops the oldest, video the newest message
+	if err := queue.push(ctx, &DataPacket{Type: AudioDataType}); err != nil {
+		t.Fatal(err)
+	}
+	if err := queue.push(ctx, &DataPacket{Type: VideoDataType}); err != ErrQueueFull {
+		t.Fatal(err)
+	}
+	// a try push never waits, also under the block policy
+	if err := queue.tryPush(&DataPacket{Type: TextDataType}); err != ErrQueueFull {
+		t.Fatal(err)
+	}
+	if state := queue.state(); state.Length != 1 || state.Dropped != 3 {
+		t.Fatalf("%+v", state)
+	}
+
+	// a push under the block policy waits for free space up to its deadline
+	timeout, cancel := context.WithTimeout(ctx, 10*time.Millisecond)
+	defer cancel()
+	if err := queue.push(timeout, &DataPacket{Type: TextDataType}); err != context.DeadlineExceeded {
+		t.Fatal(err)
+	}
+	go func() {
+		time.Sleep(10 * time.Millisecond)
+		if dp, ok := queue.pop(); ok {
+			dp.Release()
+		}
+	}()
+	if err := queue.push(ctx, &DataPacket{Type: TextDataType}); err != nil {
+		t.Fatal(err)
+	}
+	if state := queue.state(); state.Length != 1 || state.Dropped != 4 {
+		t.Fatalf("%+v", state)
+	}
+}
+
+func TestSendQueuePushAll(t *testing.T) {
+	queue := newSendQueue(4)
+	defer queue.close()
+
+	packets := func(dataType DataType, n int) []*DataPacket {
+		dps := make([]*DataPacket, n)
+		for i := range dps {
+			dps[i] = newPooledDataPacket(dataType, "", nil, nil)
+		}
+		return dps
+	}
+
+	if err := queue.tryPushAll(packets(TextDataType, 3)); err != nil {
+		t.Fatal(err)
+	}
+	// two messages don't fit into the one free slot, none is queued
+	if err := queue.tryPushAll(packets(TextDataType, 2)); err != ErrQueueFull {
+		t.Fatal(err)
+	}
+	if state := queue.state(); state.Length != 3 || state.Dropped != 2 {
+		t.Fatalf("%+v", state)
+	}
+
+	// audio evicts its own old messages only, and only if all fit then
+	if err := queue.tryPushAll(packets(AudioDataType, 1)); err != nil {
+		t.Fatal(err)
+	}
+	if err := queue.tryPushAll(packets(AudioDataType, 2)); err != ErrQueueFull {
+		t.Fatal(err)
+	}
+	if state := queue.state(); state.Length != 4 || state.Dropped != 4 {
+		t.Fatalf("%+v", state)
+	}
+	if err := queue.tryPushAll(packets(AudioDataType, 1)); err != nil {
+		t.Fatal(err)
+	}
+	if state := queue.state(); state.Length != 4 || state.Dropped != 5 {
+		t.Fatalf("%+v", state)
+	}
+}
+
+func BenchmarkSendQueuePushPop(b *testing.B) {
+	ctx := context.Background()
+	queue := newSendQueue(0)
+	defer queue.close()
+
+	dp := &DataPacket{Type: TextDataType, Payload: make([]byte, 1024)}
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		if err := queue.push(ctx, dp); err != nil {
+			b.Fatal(err)
+		}
+		if _, ok := queue.pop(); !ok {
+			b.Fatal("pop")
+		}
+	}
+}
+
+// BenchmarkSendQueueHandoff measures a producer and the worker of a room
+// passing messages through the queue.
+func BenchmarkSendQueueHandoff(b *testing.B) {
+	ctx := context.Background()
+	queue := newSendQueue(0)
+	done := make(chan struct{})
+	go func() {
+		defer close(done)
+		for i := 0; i < b.N; i++ {
+			queue.pop()
+		}
+	}()
+
+	dp := &DataPacket{Type: TextDataType, Payload: make([]byte, 1024)}
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		if err := queue.push(ctx, dp); err != nil {
+			b.Fatal(err)
+		}
+	}
+	<-done
+	queue.close()
+}
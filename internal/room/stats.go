@@ -0,0 +1,133 @@
+package room
+
+import (
+	"math/bits"
+	"sync/atomic"
+	"time"
+)
+
+const (
+	// bucket 0 counts latencies below 256ns, bucket i below 256ns<<i and
+	// the last bucket everything slower
+	LatencyBuckets  = 16
+	latencyMinShift = 8
+)
+
+// DropReason tells why a received packet was not delivered.
+type DropReason int
+
+const (
+	// NotUserDataDropReason counts packets which are not user data.
+	NotUserDataDropReason DropReason = iota
+	// UnknownKeyDropReason counts packets of senders or key ids without
+	// an rx key.
+	UnknownKeyDropReason
+	// DecryptDropReason counts packets which failed authentication.
+	DecryptDropReason
+	// BadFrameDropReason counts packets with an invalid frame header.
+	BadFrameDropReason
+	// OversizeDropReason counts messages larger than the room buffer size.
+	OversizeDropReason
+	// NoBufferDropReason counts packets dropped for lack of receive memory.
+	NoBufferDropReason
+	// IncompleteDropReason counts messages which were never reassembled.
+	IncompleteDropReason
+	// QueueFullDropReason counts messages dropped by a receive queue.
+	QueueFullDropReason
+	// HandlerBusyDropReason counts messages dropped by a busy data handler.
+	HandlerBusyDropReason
+	// ClosedDropReason counts messages received while the room was closing.
+	ClosedDropReason
+	// LateDropReason counts audio frames which came too late for playout
+	// or were skipped to bring playout delay back to its target.
+	LateDropReason
+	// UnsubscribedDropReason counts packets of data types or senders the
+	// room is not subscribed to.
+	UnsubscribedDropReason
+	// DecryptBacklogDropReason counts frames dropped by a full decrypt
+	// worker queue, before they were opened.
+	DecryptBacklogDropReason
+	endDropReason
+)
+
+type Stats struct {
+	PacketsIn  [endDataType]uint64
+	BytesIn    [endDataType]uint64
+	PacketsOut [endDataType]uint64
+	BytesOut   [endDataType]uint64
+	Drops      [endDropReason]uint64
+
+	QueueLength    int
+	QueueHighWater int
+	QueueBytes     int
+
+	EncryptLatency [LatencyBuckets]uint64
+	DecryptLatency [LatencyBuckets]uint64
+}
+
+type latencyHistogram [LatencyBuckets]atomic.Uint64
+
+func (p *latencyHistogram) observe(start time.Time) {
+	bucket := bits.Len64(uint64(time.Since(start)) >> latencyMinShift)
+	if bucket >= LatencyBuckets {
+		bucket = LatencyBuckets - 1
+	}
+	p[bucket].Add(1)
+}
+
+// add counts the observations of src once more, for a message sealed once
+// for several rooms.
+func (p *latencyHistogram) add(src *latencyHistogram) {
+	for i := range src {
+		if n := src[i].Load(); n != 0 {
+			p[i].Add(n)
+		}
+	}
+}
+
+func (p *latencyHistogram) load(dst *[LatencyBuckets]uint64) {
+	for i := range p {
+		dst[i] = p[i].Load()
+	}
+}
+
+// roomStats is updated with plain atomic adds from the receive and send
+// paths, so it is always on.
+type roomStats struct {
+	packetsIn  [endDataType]atomic.Uint64
+	bytesIn    [endDataType]atomic.Uint64
+	packetsOut [endDataType]atomic.Uint64
+	bytesOut   [endDataType]atomic.Uint64
+	drops      [endDropReason]atomic.Uint64
+
+	encryptLatency latencyHistogram
+	decryptLatency latencyHistogram
+}
+
+func (p *roomStats) drop(reason DropReason) {
+	p.drops[reason].Add(1)
+}
+
+func (p *roomStats) received(dp *DataPacket) {
+	p.packetsIn[dp.Type].Add(1)
+	p.bytesIn[dp.Type].Add(uint64(len(dp.Payload)))
+}
+
+func (p *roomStats) sent(dataType DataType, size int) {
+	p.packetsOut[dataType].Add(1)
+	p.bytesOut[dataType].Add(uint64(size))
+}
+
+func (p *roomStats) load(dst *Stats) {
+	for t := range p.packetsIn {
+		dst.PacketsIn[t] = p.packetsIn[t].Load()
+		dst.BytesIn[t] = p.bytesIn[t].Load()
+		dst.PacketsOut[t] = p.packetsOut[t].Load()
+		dst.BytesOut[t] = p.bytesOut[t].Load()
+	}
+	for r := range p.drops {
+		dst.Drops[r] = p.drops[r].Load()
+	}
+	p.encryptLatency.load(&dst.EncryptLatency)
+	p.decryptLatency.load(&dst.DecryptLatency)
+}
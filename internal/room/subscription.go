@@ -0,0 +1,63 @@
+package room
+
+// DataTypeMask selects data types, the type t by the bit 1 << t.
+type DataTypeMask uint32
+
+const (
+	AllDataTypes DataTypeMask = 1<<endDataType - 1
+)
+
+func (p DataTypeMask) Has(dataType DataType) bool {
+	return p&(1<<dataType) != 0
+}
+
+// subscription filters received packets by data type and sender before
+// they are decrypted.
+type subscription struct {
+	types  DataTypeMask
+	idents map[string]struct{}
+}
+
+func newSubscription(types DataTypeMask, idents []string) *subscription {
+	sub := &subscription{types: types}
+	if len(idents) != 0 {
+		sub.idents = make(map[string]struct{}, len(idents))
+		for _, ident := range idents {
+			sub.idents[ident] = struct{}{}
+		}
+	}
+	return sub
+}
+
+func (p *subscription) accepts(dataType DataType, ident string) bool {
+	if !p.types.Has(dataType) {
+		return false
+	}
+	if p.idents == nil {
+		return true
+	}
+	_, ok := p.idents[ident]
+	return ok
+}
+
+// SetSubscription makes the room accept only packets of the data types in
+// the mask from the given senders, or from all senders when there are
+// none. Other packets are dropped before they are decrypted.
+func (p *secureRoom) SetSubscription(types DataTypeMask, idents []string) {
+	if types == AllDataTypes && len(idents) == 0 {
+		p.subscription.Store(nil)
+		return
+	}
+	p.subscription.Store(newSubscription(types, idents))
+}
+
+// accepts tells whether a packet is subscribed to and counts the drop
+// when it is not.
+func (p *secureRoom) accepts(dataType DataType, ident string) bool {
+	sub := p.subscription.Load()
+	if sub == nil || sub.accepts(dataType, ident) {
+		return true
+	}
+	p.stats.drop(UnsubscribedDropReason)
+	return false
+}
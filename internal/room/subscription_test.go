@@ -0,0 +1,55 @@
+package room
+
+import (
+	"context"
+	"testing"
+)
+
+func TestSubscriptionDropsBeforeDecrypt(t *testing.T) {
+	room, keyID, cipher := newKeyedRoom(t, &ConnectInfo{BuffSize: 1 << 16}, "a", "b")
+	defer room.Close()
+
+	frame := func(dataType DataType) []byte {
+		sealed := &sealedMessage{}
+		if err := sealed.seal(keyID, cipher, nil, &DataPacket{Type: dataType, Payload: []byte{1}}, &room.stats.encryptLatency); err != nil {
+			t.Fatal(err)
+		}
+		return sealed.frames[0]
+	}
+
+	room.SetSubscription(DataTypeMask(1)<<TextDataType, []string{"a"})
+
+	// broken frames of other types and senders would fail to decrypt or
+	// find no key, if they were opened at all
+	video := frame(VideoDataType)
+	video[len(video)-1] ^= 1
+	room.openData(video, "a")
+	room.openData(frame(TextDataType), "b")
+	room.openData(frame(TextDataType), "c")
+	room.openData(frame(TextDataType), "a")
+
+	var stats Stats
+	room.stats.load(&stats)
+	if stats.Drops[UnsubscribedDropReason] != 3 || stats.Drops[DecryptDropReason] != 0 || stats.Drops[UnknownKeyDropReason] != 0 {
+		t.Fatalf("drops %v", stats.Drops)
+	}
+	for _, n := range stats.DecryptLatency[1:] {
+		stats.DecryptLatency[0] += n
+	}
+	if stats.DecryptLatency[0] != 1 {
+		t.Fatalf("%d frames decrypted, want 1", stats.DecryptLatency[0])
+	}
+
+	dp, err := room.ReceiveDataPacket(context.Background())
+	if err != nil || dp.Type != TextDataType || dp.Ident != "a" {
+		t.Fatal(dp, err)
+	}
+	dp.Release()
+
+	// the full mask without senders accepts everything again
+	room.SetSubscription(AllDataTypes, nil)
+	room.openData(frame(VideoDataType), "b")
+	if dp, ok, _ := room.recvQueue.tryPop(); !ok || dp.Ident != "b" {
+		t.Fatal("video of b dropped")
+	}
+}
@@ -0,0 +1,130 @@
+package room
+
+import (
+	"strings"
+
+	lksdk "github.com/livekit/server-sdk-go/v2"
+	"github.com/number571/clivekit/internal/loopback"
+)
+
+const (
+	// LoopbackScheme selects the in-process transport. Rooms connected to
+	// the same loopback host and room name exchange data without a server.
+	LoopbackScheme = "loopback://"
+)
+
+var (
+	_ ITransport = &lksdkTransport{}
+	_ ITransport = &loopbackTransport{}
+)
+
+// connectTransport connects the room with callbacks bound to the transport
+// generation, so that events of a replaced transport are ignored.
+func connectTransport(room *secureRoom, connInfo *ConnectInfo, gen uint64) (ITransport, error) {
+	if network, ok := loopbackNetwork(connInfo); ok {
+		endpoint, err := loopback.Join(
+			network,
+			connInfo.ParticipantIdentity,
+			connInfo.Loopback,
+			room.onData,
+			func() { room.onTransportLost(gen) },
+		)
+		if err != nil {
+			return nil, err
+		}
+		return &loopbackTransport{endpoint: endpoint}, nil
+	}
+
+	roomCallback := &lksdk.RoomCallback{
+		ParticipantCallback: lksdk.ParticipantCallback{
+			OnDataPacket:      room.onDataPacket,
+			OnTrackSubscribed: room.onTrackSubscribed,
+		},
+		OnDisconnected: func() { room.onTransportLost(gen) },
+		OnReconnecting: func() { room.onTransportResuming(gen) },
+		OnReconnected:  func() { room.onTransportResumed(gen) },
+	}
+	lksdkRoom, err := lksdk.ConnectToRoom(connInfo.Host, connInfo.ConnectInfo, roomCallback)
+	if err != nil {
+		return nil, err
+	}
+	return &lksdkTransport{room: lksdkRoom}, nil
+}
+
+// loopbackNetwork returns the in-process network of a loopback host.
+func loopbackNetwork(connInfo *ConnectInfo) (string, bool) {
+	name, ok := strings.CutPrefix(connInfo.Host, LoopbackScheme)
+	if !ok {
+		return "", false
+	}
+	return name + "/" + connInfo.RoomName, true
+}
+
+// DropLoopbackLink drops the link of a room connected to a loopback host,
+// as a failed network would, so that the room reconnects.
+func (p *secureRoom) DropLoopbackLink() error {
+	network, ok := loopbackNetwork(p.connInfo)
+	if !ok {
+		return ErrNotSupported
+	}
+	if !loopback.Disconnect(network, p.connInfo.ParticipantIdentity) {
+		return ErrNotConnected
+	}
+	return nil
+}
+
+type lksdkTransport struct {
+	room *lksdk.Room
+}
+
+func (p *lksdkTransport) PublishData(payload []byte, reliable bool, destinations []string) error {
+	if len(destinations) != 0 {
+		return p.room.LocalParticipant.PublishDataPacket(
+			lksdk.UserData(payload),
+			lksdk.WithDataPublishReliable(reliable),
+			lksdk.WithDataPublishDestination(destinations),
+		)
+	}
+	return p.room.LocalParticipant.PublishDataPacket(
+		lksdk.UserData(payload),
+		lksdk.WithDataPublishReliable(reliable),
+	)
+}
+
+func (p *lksdkTransport) PublishTrack(track *lksdk.LocalTrack, opts *lksdk.TrackPublicationOptions) (string, error) {
+	publication, err := p.room.LocalParticipant.PublishTrack(track, opts)
+	if err != nil {
+		return "", err
+	}
+	return publication.SID(), nil
+}
+
+func (p *lksdkTransport) UnpublishTrack(sid string) error {
+	return p.room.LocalParticipant.UnpublishTrack(sid)
+}
+
+func (p *lksdkTransport) Disconnect() {
+	p.room.Disconnect()
+}
+
+// loopbackTransport carries data messages only, media tracks need RTP
+// sessions of a real connection.
+type loopbackTransport struct {
+	endpoint loopback.IEndpoint
+}
+
+func (p *loopbackTransport) PublishData(payload []byte, reliable bool, destinations []string) error {
+	return p.endpoint.Send(payload, reliable, destinations)
+}
+
+func (p *loopbackTransport) PublishTrack(*lksdk.LocalTrack, *lksdk.TrackPublicationOptions) (string, error) {
+	return "", ErrNotSupported
+}
+
+func (p *loopbackTransport) UnpublishTrack(string) error {
+	return ErrNotSupported
+}
+
+func (p *loopbackTransport) Disconnect() {
+	p.endpoint.Close()
+}
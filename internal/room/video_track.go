@@ -0,0 +1,290 @@
+package room
+
+import (
+	"time"
+
+	lksdk "github.com/livekit/server-sdk-go/v2"
+	"github.com/pion/rtp/codecs"
+	"github.com/pion/webrtc/v4"
+	"github.com/pion/webrtc/v4/pkg/media"
+)
+
+const (
+	videoTrackName       = "clivekit-video"
+	videoClockRate       = 90000
+	defaultFrameDuration = time.Second / 30
+	// the least interval between keyframe requests of one track
+	pliInterval = 500 * time.Millisecond
+)
+
+type VideoFormat struct {
+	Width  int
+	Height int
+}
+
+// videoPublisher seals the NAL units of access units and writes them to the
+// local track, which packetizes them by NAL unit.
+type videoPublisher struct {
+	track    *lksdk.LocalTrack
+	trackSID string
+	options  *lksdk.TrackPublicationOptions
+	lastTime time.Duration
+	hasTime  bool
+	frame    []byte
+	sealBuff []byte
+}
+
+// PublishVideoTrack publishes an H.264 track of the room. As with audio,
+// the samples are sealed with the tx key of the room.
+func (p *secureRoom) PublishVideoTrack(format VideoFormat) error {
+	p.videoMtx.Lock()
+	defer p.videoMtx.Unlock()
+
+	if p.videoPublisher != nil {
+		return ErrTrackPublished
+	}
+
+	transport := p.getTransport()
+	if transport == nil {
+		return ErrNotConnected
+	}
+
+	track, err := lksdk.NewLocalTrack(webrtc.RTPCodecCapability{
+		MimeType:    webrtc.MimeTypeH264,
+		ClockRate:   videoClockRate,
+		SDPFmtpLine: "level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f",
+	})
+	if err != nil {
+		return err
+	}
+
+	options := &lksdk.TrackPublicationOptions{
+		Name:        videoTrackName,
+		VideoWidth:  format.Width,
+		VideoHeight: format.Height,
+	}
+	trackSID, err := transport.PublishTrack(track, options)
+	if err != nil {
+		return err
+	}
+
+	p.videoPublisher = &videoPublisher{track: track, trackSID: trackSID, options: options}
+	return nil
+}
+
+// WriteVideoFrame sends one Annex-B access unit presented at timestamp.
+// Parameter sets and delimiters stay readable for the SFU, every other NAL
+// unit keeps its header and gets the rest sealed.
+func (p *secureRoom) WriteVideoFrame(accessUnit []byte, timestamp time.Duration) error {
+	p.videoMtx.Lock()
+	defer p.videoMtx.Unlock()
+
+	pub := p.videoPublisher
+	if pub == nil {
+		return ErrNoTrack
+	}
+
+	keyID, cipher, ok := p.cipherManager.GetTX()
+	if !ok {
+		return ErrGetTXCipher
+	}
+
+	var (
+		err  error
+		rest = accessUnit
+		nal  []byte
+	)
+	pub.frame = pub.frame[:0]
+	for len(rest) != 0 {
+		nal, rest = nextNALUnit(rest)
+		if len(nal) == 0 {
+			continue
+		}
+
+		pub.frame = append(pub.frame, annexBStartCode...)
+		if isClearNAL(nal[0] & nalTypeMask) {
+			pub.frame = append(pub.frame, nal...)
+			continue
+		}
+
+		start := time.Now()
+		pub.sealBuff, err = sealSample(pub.sealBuff, keyID, cipher, nal[1:])
+		if err != nil {
+			return err
+		}
+		p.stats.encryptLatency.observe(start)
+
+		pub.frame = append(pub.frame, nal[0])
+		pub.frame = appendEscaped(pub.frame, pub.sealBuff)
+		pub.frame = append(pub.frame, nalTrailer)
+	}
+	if len(pub.frame) == 0 {
+		return nil
+	}
+
+	duration := defaultFrameDuration
+	if pub.hasTime && timestamp > pub.lastTime {
+		duration = timestamp - pub.lastTime
+	}
+	pub.lastTime, pub.hasTime = timestamp, true
+
+	// the track packetizes the sample before returning
+	return pub.track.WriteSample(media.Sample{Data: pub.frame, Duration: duration}, nil)
+}
+
+func (p *secureRoom) UnpublishVideoTrack() error {
+	p.videoMtx.Lock()
+	defer p.videoMtx.Unlock()
+
+	pub := p.videoPublisher
+	if pub == nil {
+		return ErrNoTrack
+	}
+	p.videoPublisher = nil
+
+	transport := p.getTransport()
+	if transport == nil {
+		return nil
+	}
+	return transport.UnpublishTrack(pub.trackSID)
+}
+
+// SubscribeVideo makes the room queue the access units of remote video
+// tracks as video packets of the track owner.
+func (p *secureRoom) SubscribeVideo(enabled bool) {
+	p.videoEnabled.Store(enabled)
+}
+
+// readVideoTrack joins RTP packets into access units. After a lost packet
+// it drops access units and asks the sender for a keyframe until one
+// arrives, so that decoders never see a broken reference chain.
+func (p *secureRoom) readVideoTrack(track *webrtc.TrackRemote, rp *lksdk.RemoteParticipant) {
+	defer p.trackReaders.Done()
+
+	var (
+		ident        = rp.Identity()
+		depacketizer = &codecs.H264Packet{}
+		accessUnit   []byte
+		timestamp    uint32
+		lastSeq      uint16
+		started      bool
+		broken       bool
+		needKeyframe = true
+		lastPLI      time.Time
+	)
+	requestKeyframe := func() {
+		if now := time.Now(); now.Sub(lastPLI) >= pliInterval {
+			lastPLI = now
+			rp.WritePLI(track.SSRC())
+		}
+	}
+
+	for {
+		packet, _, err := track.ReadRTP()
+		if err != nil {
+			return
+		}
+		if !p.videoEnabled.Load() {
+			started, needKeyframe = false, true
+			continue
+		}
+
+		if started && packet.SequenceNumber != lastSeq+1 {
+			broken = true
+		}
+		if len(accessUnit) != 0 && packet.Timestamp != timestamp {
+			// the marker of the previous access unit was lost
+			accessUnit, broken = accessUnit[:0], true
+		}
+		lastSeq, timestamp, started = packet.SequenceNumber, packet.Timestamp, true
+
+		nals, err := depacketizer.Unmarshal(packet.Payload)
+		if err != nil {
+			broken = true
+		}
+		accessUnit = append(accessUnit, nals...)
+
+		if !packet.Marker {
+			continue
+		}
+
+		if broken {
+			p.stats.drop(IncompleteDropReason)
+			needKeyframe = true
+		} else if needKeyframe && !hasIDR(accessUnit) {
+			p.stats.drop(IncompleteDropReason)
+		} else {
+			needKeyframe = false
+			p.deliverAccessUnit(ident, accessUnit)
+		}
+		if needKeyframe {
+			requestKeyframe()
+		}
+		accessUnit, broken = accessUnit[:0], false
+	}
+}
+
+func hasIDR(accessUnit []byte) bool {
+	for rest := accessUnit; len(rest) != 0; {
+		var nal []byte
+		if nal, rest = nextNALUnit(rest); len(nal) != 0 && nal[0]&nalTypeMask == nalTypeIDR {
+			return true
+		}
+	}
+	return false
+}
+
+// deliverAccessUnit opens the sealed NAL units of the access unit and
+// queues the plain Annex-B access unit.
+func (p *secureRoom) deliverAccessUnit(ident string, accessUnit []byte) {
+	if !p.accepts(VideoDataType, ident) {
+		return
+	}
+
+	buffer, ok := p.buffPool.Get(len(accessUnit))
+	if !ok {
+		p.stats.drop(NoBufferDropReason)
+		return
+	}
+
+	var (
+		out  = buffer.Cap()[:0]
+		rest = accessUnit
+		nal  []byte
+	)
+	for len(rest) != 0 {
+		nal, rest = nextNALUnit(rest)
+		if len(nal) == 0 {
+			continue
+		}
+		if cap(out)-len(out) < len(annexBStartCode)+len(nal) {
+			p.stats.drop(OversizeDropReason)
+			buffer.Release()
+			return
+		}
+
+		out = append(out, annexBStartCode...)
+		if isClearNAL(nal[0] & nalTypeMask) {
+			out = append(out, nal...)
+			continue
+		}
+
+		sealed := unescapeInPlace(nal[1:])
+		if len(sealed) == 0 || sealed[len(sealed)-1] != nalTrailer {
+			p.stats.drop(BadFrameDropReason)
+			buffer.Release()
+			return
+		}
+
+		out = append(out, nal[0])
+		plaintext, ok := p.openPacketTo(out[len(out):], ident, sealed[:len(sealed)-1])
+		if !ok {
+			buffer.Release()
+			return
+		}
+		out = out[:len(out)+len(plaintext)]
+	}
+
+	buffer.SetSize(len(out))
+	p.deliver(newPooledDataPacket(VideoDataType, ident, buffer.Bytes(), buffer))
+}
@@ -0,0 +1,7 @@
+package tuning
+
+import "errors"
+
+var (
+	ErrMaxProcs = errors.New("max procs")
+)
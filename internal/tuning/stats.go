@@ -0,0 +1,103 @@
+package tuning
+
+import (
+	"math"
+	"runtime/metrics"
+	"sync"
+	"time"
+)
+
+const (
+	heapObjectsMetric = "/memory/classes/heap/objects:bytes"
+	heapGoalMetric    = "/gc/heap/goal:bytes"
+	totalMemoryMetric = "/memory/classes/total:bytes"
+	goroutinesMetric  = "/sched/goroutines:goroutines"
+	gcCyclesMetric    = "/gc/cycles/total:gc-cycles"
+	gcPausesMetric    = "/sched/pauses/total/gc:seconds"
+	gcPercentMetric   = "/gc/gogc:percent"
+	memoryLimitMetric = "/gc/gomemlimit:bytes"
+)
+
+// Stats is a snapshot of the runtime. The pause percentiles are the upper
+// bounds of histogram buckets over all pauses since the start of the
+// process.
+type Stats struct {
+	Config
+
+	// HeapBytes counts the heap objects, live or not yet swept.
+	HeapBytes   uint64
+	HeapGoal    uint64
+	TotalBytes  uint64
+	Goroutines  uint64
+	GCCycles    uint64
+	GCPauses    uint64
+	GCPauseP50  time.Duration
+	GCPauseP99  time.Duration
+	GCPauseP999 time.Duration
+	GCPauseMax  time.Duration
+}
+
+var (
+	statsMtx     = &sync.Mutex{}
+	statsSamples = []metrics.Sample{
+		{Name: heapObjectsMetric},
+		{Name: heapGoalMetric},
+		{Name: totalMemoryMetric},
+		{Name: goroutinesMetric},
+		{Name: gcCyclesMetric},
+		{Name: gcPausesMetric},
+	}
+)
+
+// ReadStats reads the runtime metrics without stopping the world.
+func ReadStats(stats *Stats) {
+	statsMtx.Lock()
+	defer statsMtx.Unlock()
+
+	metrics.Read(statsSamples)
+
+	stats.Config = current()
+	stats.HeapBytes = statsSamples[0].Value.Uint64()
+	stats.HeapGoal = statsSamples[1].Value.Uint64()
+	stats.TotalBytes = statsSamples[2].Value.Uint64()
+	stats.Goroutines = statsSamples[3].Value.Uint64()
+	stats.GCCycles = statsSamples[4].Value.Uint64()
+
+	stats.GCPauses = 0
+	if statsSamples[5].Value.Kind() != metrics.KindFloat64Histogram {
+		return
+	}
+	pauses := statsSamples[5].Value.Float64Histogram()
+	for _, count := range pauses.Counts {
+		stats.GCPauses += count
+	}
+	stats.GCPauseP50 = quantile(pauses, stats.GCPauses, 0.5)
+	stats.GCPauseP99 = quantile(pauses, stats.GCPauses, 0.99)
+	stats.GCPauseP999 = quantile(pauses, stats.GCPauses, 0.999)
+	stats.GCPauseMax = quantile(pauses, stats.GCPauses, 1)
+}
+
+// quantile returns the upper bound of the bucket holding the quantile q of
+// the histogram of seconds, or its lower bound for the last bucket.
+func quantile(hist *metrics.Float64Histogram, total uint64, q float64) time.Duration {
+	if total == 0 {
+		return 0
+	}
+	rank := uint64(math.Ceil(q * float64(total)))
+	if rank == 0 {
+		rank = 1
+	}
+	var seen uint64
+	for i, count := range hist.Counts {
+		seen += count
+		if seen < rank {
+			continue
+		}
+		bound := hist.Buckets[i+1]
+		if math.IsInf(bound, 1) {
+			bound = hist.Buckets[i]
+		}
+		return time.Duration(bound * float64(time.Second))
+	}
+	return 0
+}
@@ -0,0 +1,79 @@
+package tuning
+
+import (
+	"math"
+	"runtime"
+	"runtime/debug"
+	"runtime/metrics"
+	"sync"
+)
+
+// Config holds the settings of the Go runtime embedded in the library.
+// A zero field keeps the current setting.
+type Config struct {
+	MaxProcs int
+	// GCPercent is the heap growth which triggers a collection, as GOGC.
+	// A negative value turns off collections by heap growth.
+	GCPercent int
+	// MemoryLimit is the soft limit of the memory of the runtime in bytes,
+	// as GOMEMLIMIT. A negative value removes the limit.
+	MemoryLimit int64
+}
+
+var (
+	configMtx = &sync.Mutex{}
+)
+
+// Configure applies the set fields of the config and returns the previous
+// settings. It is safe to call at any time; a smaller GOMAXPROCS stops the
+// world once.
+func Configure(config Config) (Config, error) {
+	if config.MaxProcs < 0 {
+		return Config{}, ErrMaxProcs
+	}
+
+	configMtx.Lock()
+	defer configMtx.Unlock()
+
+	prev := current()
+	if config.MaxProcs != 0 {
+		runtime.GOMAXPROCS(config.MaxProcs)
+	}
+	switch {
+	case config.GCPercent < 0:
+		debug.SetGCPercent(-1)
+	case config.GCPercent > 0:
+		debug.SetGCPercent(config.GCPercent)
+	}
+	switch {
+	case config.MemoryLimit < 0:
+		debug.SetMemoryLimit(math.MaxInt64)
+	case config.MemoryLimit > 0:
+		debug.SetMemoryLimit(config.MemoryLimit)
+	}
+	return prev, nil
+}
+
+// current returns the settings in the form of a config, with -1 for the
+// settings which are off. They are read from the metrics, because reading
+// them by debug.SetGCPercent would wait for a running collection.
+func current() Config {
+	samples := []metrics.Sample{
+		{Name: gcPercentMetric},
+		{Name: memoryLimitMetric},
+	}
+	metrics.Read(samples)
+
+	config := Config{
+		MaxProcs:    runtime.GOMAXPROCS(0),
+		GCPercent:   int(int64(samples[0].Value.Uint64())),
+		MemoryLimit: int64(samples[1].Value.Uint64()),
+	}
+	if config.GCPercent < 0 {
+		config.GCPercent = -1
+	}
+	if config.MemoryLimit == math.MaxInt64 {
+		config.MemoryLimit = -1
+	}
+	return config
+}